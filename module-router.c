@@ -19,10 +19,14 @@
 #include <pulsecore/core.h>
 #include <pulsecore/module.h>
 #include <pulsecore/modargs.h>
+#include <pulsecore/core-subscribe.h>
 #include <pulsecore/sink.h>
 #include <pulsecore/sink-input.h>
 #include <pulse/version.h>
 #include <router-userdata.h>
+#include <router-strings.h>
+#include <router-map.h>
+#include <router-connection.h>
 #include <router-dbusif.h>
 
 #define GENIVI_DBUS_PLUGIN       1
@@ -42,7 +46,6 @@
 #define AM_ROUTING_DBUS_NAME "org.genivi.audiomanager"
 #define AM_ROUTING_DBUS_INTERFACE_NAME "org.genivi.audiomanager.routinginterface"
 #define AM_ROUTING_DBUS_PATH "/org/genivi/audiomanager/routinginterface"
-#define AM_COMMAND_SIGNAL_WATCH_RULE "type='signal',interface='org.genivi.audiomanager.commandinterface'"
 
 #define DS_UNKNOWN    0
 #define DS_CONTROLLED 1
@@ -58,7 +61,15 @@ PA_MODULE_AUTHOR("Advanced Driver Information Technology");
 PA_MODULE_DESCRIPTION("PulseAudio router plug-in");
 PA_MODULE_VERSION( PACKAGE_VERSION);
 PA_MODULE_LOAD_ONCE( true);
-PA_MODULE_USAGE("");
+PA_MODULE_USAGE(
+        "am_reply_timeout=<deadline in ms for the replies of the audiomanager> "
+        "am_address=<D-Bus address of the audiomanager for a peer to peer connection>");
+
+static const char* const valid_modargs[] = {
+    "am_reply_timeout",
+    "am_address",
+    NULL
+};
 
 struct router_hooks {
     pa_hook_slot *hook_slot_sink_input_put;
@@ -69,8 +80,19 @@ struct router_hooks {
     pa_hook_slot *hook_slot_sink_input_new;
     pa_hook_slot *hook_slot_source_new;
     pa_hook_slot *hook_slot_source_output_new;
+    pa_hook_slot *hook_slot_sink_put;
+    pa_hook_slot *hook_slot_sink_unlink;
+    pa_hook_slot *hook_slot_source_put;
+    pa_hook_slot *hook_slot_source_unlink;
+    pa_subscription *module_subscription;
 };
 
+/* a source/sink whose peek/registration with the audiomanager is still in flight */
+typedef struct {
+    char *name;
+    pa_idxset *streams;
+} router_admission;
+
 /**
  * @brief This function is registered with the dbus interface module, it gets called when command side
  * Notification cbNewMainConnection is received.
@@ -93,7 +115,7 @@ static void cb_new_main_connection(struct userdata *u, am_main_connection_t *con
 static void cb_removed_main_connection(struct userdata *u, uint16_t id) {
     ROUTER_FUNCTION_ENTRY;
     pa_log_debug("Main Connection removed ID = %d", id);
-    pa_hashmap_remove(u->main_connection_map, (void*) (intptr_t) id);
+    MODULE_ROUTER_FREE(router_connection_remove(u->main_connection_map, id));
     ROUTER_FUNCTION_EXIT;
 
 }
@@ -109,7 +131,7 @@ static void cb_removed_main_connection(struct userdata *u, uint16_t id) {
 static void cb_main_connection_state_changed(struct userdata *u, uint16_t id, int32_t state) {
     ROUTER_FUNCTION_ENTRY;
     pa_log_debug("Main Connection state changed  ID = %d state = %d", id, state);
-    am_main_connection_t* main_connection = pa_hashmap_get(u->main_connection_map, (void*) (intptr_t) id);
+    am_main_connection_t* main_connection = router_connection_get(u->main_connection_map, id);
     if ( main_connection != NULL ) {
         main_connection->state = state;
     }
@@ -127,29 +149,29 @@ static void print_maps(struct userdata* u)
 {
     int16_t index;
     pa_log_debug("print_maps: SinkMaps");
-    for(index = 0;index < 10;index++)
+    for(index = 0;index < u->sink_map.size;index++)
     {
         pa_log_debug("sink ID=%d, builtin=%d, source_state=%d, ptr=%p, name=%s",
-                u->sink_map[index].id,u->sink_map[index].builtin,u->sink_map[index].source_state,
-                u->sink_map[index].data,u->sink_map[index].name);
+                u->sink_map.id[index],u->sink_map.builtin[index],u->sink_map.source_state[index],
+                u->sink_map.data[index],router_map_get_name(&u->sink_map, index));
     }
     pa_log_debug("print_maps: SourceMaps");
-    for(index = 0;index < 10;index++)
+    for(index = 0;index < u->source_map.size;index++)
     {
         pa_log_debug("Source ID=%d, builtin=%d, source_state=%d, ptr=%p, name=%s",
-                u->source_map[index].id,u->source_map[index].builtin,u->source_map[index].source_state,
-                u->source_map[index].data,u->source_map[index].name);
+                u->source_map.id[index],u->source_map.builtin[index],u->source_map.source_state[index],
+                u->source_map.data[index],router_map_get_name(&u->source_map, index));
     }
     pa_log_debug("print_maps: ConenctionMaps");
     am_connect_t *c;
     void *s;
-    PA_HASHMAP_FOREACH(c, u->connection_map, s)
+    ROUTER_CONNECTION_FOREACH(c, u->connection_map, s)
     {
         pa_log_debug("Connection ID=%d, sourceID = %d, sinkID=%d",c->connection_id, c->source_id,c->sink_id);
     }
     pa_log_debug("print_maps: MainConenctionMaps");
     am_main_connection_t *mainConnection;
-    PA_HASHMAP_FOREACH(mainConnection, u->main_connection_map, s)
+    ROUTER_CONNECTION_FOREACH(mainConnection, u->main_connection_map, s)
     {
         pa_log_debug("Connection ID=%d, sourceID = %d, sinkID=%d state=%d",mainConnection->connection_id, mainConnection->source_id,mainConnection->sink_id,mainConnection->state);
     }
@@ -159,18 +181,12 @@ static void print_maps(struct userdata* u)
 
 /**
  * @brief This function gets the free index in the map. The map can be source or sink map.
+ * The map grows when all the entries are in use.
  * @param map: The pointer to the map
- * @return int16_t: The index of the free entry in the map.
- */
-static int16_t get_free_map_index(name_id_map *map) {
-    int16_t index = -1;
-    int16_t i = 0;
-    for ( int i = 0 ; i < AM_MAX_SOURCE_SINK ; i++ ) {
-        if ( map[i].name[0] == '\0' ) {
-            index = i;
-            break;
-        }
-    }
+ * @return int16_t: The index of the free entry in the map, -1 if the map cannot grow any more.
+ */
+static int16_t get_free_map_index(router_map *map) {
+    int16_t index = router_map_alloc(map);
     pa_log_debug("get_free_map_index index=%d", index);
     return index;
 }
@@ -181,15 +197,8 @@ static int16_t get_free_map_index(name_id_map *map) {
  *        map: pointer to the map either source/sink map
  * @return int16_t: The index of the map.
  */
-static int16_t get_map_index_from_id(const uint16_t id, const name_id_map *map) {
-    int16_t index = -1;
-    int16_t i = 0;
-    for ( int i = 0 ; i < AM_MAX_SOURCE_SINK ; i++ ) {
-        if ( map[i].id == id ) {
-            index = i;
-            break;
-        }
-    }
+static int16_t get_map_index_from_id(const uint16_t id, const router_map *map) {
+    int16_t index = router_map_index_from_id(map, id);
     pa_log_debug("get_map_index_from_id id=%d, index = %d", id, index);
     return index;
 }
@@ -200,15 +209,8 @@ static int16_t get_map_index_from_id(const uint16_t id, const name_id_map *map)
  *        map: pointer to the map either source/sink map
  * @return int16_t: The index of the map.
  */
-static int16_t get_map_index_from_name(const char* name, const name_id_map *map) {
-    int16_t index = -1;
-    int16_t i = 0;
-    for ( int i = 0 ; i < AM_MAX_SOURCE_SINK ; i++ ) {
-        if ( strcmp(map[i].name, name) == 0 ) {
-            index = i;
-            break;
-        }
-    }
+static int16_t get_map_index_from_name(const char* name, const router_map *map) {
+    int16_t index = router_map_index_from_name(map, name);
     pa_log_debug("get_map_index_from_name name=%s, index = %d", name, index);
     return index;
 }
@@ -220,16 +222,7 @@ static int16_t get_map_index_from_name(const char* name, const name_id_map *map)
  * @return am_connect_t: The pointer to the am_connect structure.
  */
 static am_connect_t* get_connection_from_source(struct userdata *u, uint16_t source_id) {
-    am_connect_t *c = NULL;
-    am_connect_t *ret_val = NULL;
-    void *s;
-    PA_HASHMAP_FOREACH(c, u->connection_map, s)
-    {
-        if ( c->source_id == source_id ) {
-            ret_val = c;
-            break;
-        }
-    }
+    am_connect_t *ret_val = router_connection_get_by_source(u->connection_map, source_id);
     pa_log_debug("get_connection_from_source() sourceID = %d", source_id);
     return ret_val;
 }
@@ -242,36 +235,24 @@ static am_connect_t* get_connection_from_source(struct userdata *u, uint16_t sou
  * @return am_connect_t: The pointer to the am_connect structure.
  */
 static am_connect_t* get_connection_from_src_sink(struct userdata *u, uint16_t source_id, uint16_t sink_id) {
-    am_connect_t *c = NULL;
-    am_connect_t *ret_val = NULL;
-    void *s;
-    PA_HASHMAP_FOREACH(c, u->connection_map, s)
-    {
-        if ( (c->source_id == source_id) && (c->sink_id == sink_id) ) {
-            ret_val = c;
-            break;
-        }
-    }
+    am_connect_t *ret_val = router_connection_get_by_source_sink(u->connection_map, source_id, sink_id);
     pa_log_debug("get_connection_from_src_sink ()sourceID = %d sinkID=%d", source_id, sink_id);
     return ret_val;
 }
 
 /**
- * @brief This function returns the id from the sink_input pointer
- * @param sink_input: The pointer to the sink input.
- *        map: The pointer to the sink input map
- * @return uint16_t: The id of the source
+ * @brief This function returns the id from the pulseaudio object bound to a map entry
+ * @param pa_ptr: The pointer to the sink input/source output/sink/source.
+ *        map: The pointer to the source/sink map
+ * @return uint16_t: The id of the source/sink, 0 if the object is not bound.
  */
-static uint16_t get_id_from_sink_input(pa_sink_input* sink_input, const name_id_map* map) {
+static uint16_t get_id_from_pa_pointer(const void* pa_ptr, const router_map* map) {
     uint16_t id = 0;
-    int16_t i = 0;
-    for ( int i = 0 ; i < AM_MAX_SOURCE_SINK ; i++ ) {
-        if ( map[i].data == sink_input ) {
-            id = map[i].id;
-            break;
-        }
+    int16_t index = router_map_index_from_data(map, pa_ptr);
+    if ( index != -1 ) {
+        id = map->id[index];
     }
-    pa_log_debug("get_id_from_sink_input id=%d", id);
+    pa_log_debug("get_id_from_pa_pointer id=%d", id);
     return id;
 }
 
@@ -281,13 +262,10 @@ static uint16_t get_id_from_sink_input(pa_sink_input* sink_input, const name_id_
  *        map: The pointer to the source/sink map.
  * @return None
  */
-static void remove_pa_pointer(uint16_t id, name_id_map* map) {
-    int16_t i = 0;
-    for ( int i = 0 ; i < AM_MAX_SOURCE_SINK ; i++ ) {
-        if ( map[i].id == id ) {
-            map[i].data = NULL;
-            break;
-        }
+static void remove_pa_pointer(uint16_t id, router_map* map) {
+    int16_t index = router_map_index_from_id(map, id);
+    if ( index != -1 ) {
+        router_map_set_data(map, index, NULL);
     }
     return;
 }
@@ -298,14 +276,11 @@ static void remove_pa_pointer(uint16_t id, name_id_map* map) {
  *        map: The pointer to the source/sink map.
  * @return void*: The pointer to the pulseaudio source/sinks.
  */
-static void* get_pa_pointer_from_id(uint16_t id, const name_id_map* map) {
-    int16_t i = 0;
+static void* get_pa_pointer_from_id(uint16_t id, const router_map* map) {
     void* pa_ptr = NULL;
-    for ( int i = 0 ; i < AM_MAX_SOURCE_SINK ; i++ ) {
-        if ( map[i].id == id ) {
-            pa_ptr = map[i].data;
-            break;
-        }
+    int16_t index = router_map_index_from_id(map, id);
+    if ( index != -1 ) {
+        pa_ptr = map->data[index];
     }
     return pa_ptr;
 }
@@ -316,16 +291,8 @@ static void* get_pa_pointer_from_id(uint16_t id, const name_id_map* map) {
  *         map: The pointer to the source/sink map.
  * @return int16_t: The index of the map for which the name matches.
  */
-static int16_t am_name_to_map_index(const char *name, const name_id_map *map) {
-    int16_t index = -1;
-    int16_t i = 0;
-    for ( int i = 0 ; i < AM_MAX_SOURCE_SINK ; i++ ) {
-        if ( strcmp(name, map[i].name) == 0 ) {
-            index = i;
-            break;
-        }
-    }
-    return index;
+static int16_t am_name_to_map_index(const char *name, const router_map *map) {
+    return router_map_index_from_name(map, name);
 }
 
 /**
@@ -334,15 +301,11 @@ static int16_t am_name_to_map_index(const char *name, const name_id_map *map) {
  *         map: The pointer to the source/sink map.
  * @return int16_t: The id for which the name matches in the map.
  */
-static uint16_t am_name_to_id(const char *name, const name_id_map *map) {
+static uint16_t am_name_to_id(const char *name, const router_map *map) {
     uint16_t id = 0;
-    if ( name != NULL ) {
-        for ( int i = 0 ; i < AM_MAX_SOURCE_SINK ; i++ ) {
-            if ( strcmp(map[i].name, name) == 0 ) {
-                id = map[i].id;
-                break;
-            }
-        }
+    int16_t index = router_map_index_from_name(map, name);
+    if ( index != -1 ) {
+        id = map->id[index];
     }
     pa_log_debug("am_name_to_id name:%s id:%d", name, id);
     return id;
@@ -354,13 +317,11 @@ static uint16_t am_name_to_id(const char *name, const name_id_map *map) {
  *         map: The pointer to the source/sink map.
  * @return int16_t: The id for which the name matches in the map.
  */
-static char* id_to_am_name(const uint16_t id, name_id_map *map) {
-    char *name = NULL;
-    for ( int i = 0 ; i < AM_MAX_SOURCE_SINK ; i++ ) {
-        if ( map[i].id == id ) {
-            name = map[i].name;
-            break;
-        }
+static const char* id_to_am_name(const uint16_t id, const router_map *map) {
+    const char *name = NULL;
+    int16_t index = router_map_index_from_id(map, id);
+    if ( index != -1 ) {
+        name = router_map_get_name(map, index);
     }
     return name;
 }
@@ -369,15 +330,13 @@ static char* id_to_am_name(const uint16_t id, name_id_map *map) {
  * @brief This function returns the pulseaudio property description from a given id.
  * @param: id: The audio manager id.
  *         map: The pointer to the source/sink map.
- * @return char*: The description of the source/sink.
- */
-static char* id_to_pulse_description(const uint16_t id, const name_id_map *map) {
-    char* description = NULL;
-    for ( const name_id_map *m = map ; m->name[0] != '\0' ; m++ ) {
-        if ( m->id == id ) {
-            description = (char*) m->description;
-            break;
-        }
+ * @return const char*: The description of the source/sink.
+ */
+static const char* id_to_pulse_description(const uint16_t id, const router_map *map) {
+    const char* description = NULL;
+    int16_t index = router_map_index_from_id(map, id);
+    if ( index != -1 ) {
+        description = router_map_get_description(map, index);
     }
     return description;
 }
@@ -388,15 +347,11 @@ static char* id_to_pulse_description(const uint16_t id, const name_id_map *map)
  *         map: The pointer to the source/sink map.
  * @return uint16_t: The id from the pulseaudio description.
  */
-static uint16_t pulse_description_to_am_id(const char *description, const name_id_map *map) {
+static uint16_t pulse_description_to_am_id(const char *description, const router_map *map) {
     uint16_t id = 0;
-    if ( description ) {
-        for ( const name_id_map *m = map ; m->name[0] != '\0' ; m++ ) {
-            if ( (m->description) && (strcmp(m->description, description) == 0) ) {
-                id = m->id;
-                break;
-            }
-        }
+    int16_t index = router_map_index_from_description(map, description);
+    if ( index != -1 ) {
+        id = map->id[index];
     }
     return id;
 }
@@ -407,58 +362,40 @@ static uint16_t pulse_description_to_am_id(const char *description, const name_i
  *         map: The pointer to the source/sink map.
  * @return bool: true if source/sink is built-in and vice versa.
  */
-static bool is_source_sink_builtin(const uint16_t id, const name_id_map *map) {
+static bool is_source_sink_builtin(const uint16_t id, const router_map *map) {
     bool builtin = false;
-    if ( id ) {
-        for ( const name_id_map *m = map ; m->name[0] != '\0' ; m++ ) {
-            if ( m->id == id ) {
-                builtin = m->builtin;
-                break;
-            }
-        }
+    int16_t index = router_map_index_from_id(map, id);
+    if ( index != -1 ) {
+        builtin = map->builtin[index];
     }
     return builtin;
 }
 
 /**
- * @brief This function returns the sink input pointer from the audiomanager id.
+ * @brief This function returns the sink input which a loopback module created on a builtin sink.
  * @param: u: The user data pointer.
  *         sink_id: The sink id.
+ *         loopback_module: The loopback module.
  * @return pa_sink_input*: The pointer to the pulse audio sink input.
  */
-static pa_sink_input* am_id_to_loopbacked_sink_input(struct userdata*u, uint16_t sink_id) {
+static pa_sink_input* am_id_to_loopbacked_sink_input(struct userdata*u, uint16_t sink_id, pa_module* loopback_module) {
     pa_sink_input* sink_input = NULL;
     pa_sink_input* return_sink_input = NULL;
-    char* sink_name = id_to_am_name(sink_id, u->sink_map);
+    pa_sink* sink = NULL;
     uint32_t index;
-    PA_IDXSET_FOREACH(sink_input, u->core->sink_inputs, index)
-    {
-        if ( !strcmp(sink_name, sink_input->sink->name) ) {
-            return_sink_input = sink_input;
-            break;
-        }
+    if ( is_source_sink_builtin(sink_id, &u->sink_map) ) {
+        sink = (pa_sink*) get_pa_pointer_from_id(sink_id, &u->sink_map);
     }
-    return return_sink_input;
-}
-
-/**
- * @brief This function returns the sink input pointer from the audiomanager id.
- * @param: u: The user data pointer.
- *         sink_id: The sink id.
- * @return pa_sink_input*: The pointer to the pulse audio sink input.
- */
-static pa_source* am_name_to_pa_source(struct userdata*u, char* source_name) {
-    pa_source* source = NULL;
-    pa_source* output_source = NULL;
-    uint32_t index;
-    PA_IDXSET_FOREACH(source, u->core->sources, index)
-    {
-        if ( !strcmp(source_name, source->name) ) {
-            output_source = source;
-            break;
+    if ( sink != NULL ) {
+        PA_IDXSET_FOREACH(sink_input, sink->inputs, index)
+        {
+            if ( sink_input->module == loopback_module ) {
+                return_sink_input = sink_input;
+                break;
+            }
         }
     }
-    return output_source;
+    return return_sink_input;
 }
 
 /**
@@ -506,76 +443,15 @@ static pa_sink* pulse_description_to_loopbacked_sink(const struct userdata* u, c
 }
 
 /**
- * @brief This function returns the source output pointer from the pulseaudio description.
- * @param: u: The user data pointer.
- *         description: The pulseaudio description property.
- * @return pa_source_output*: The pointer to the pulse audio source output.
- */
-static pa_source_output* pulse_description_to_loopbacked_source_output(const struct userdata* u,
-        const char *description) {
-    pa_source_output* pulse_source_output = NULL;
-    pa_source_output* iterator;
-    uint32_t index;
-    char Loopback_description[1024];
-    sprintf(Loopback_description, "Loopback to %s", description);
-    if ( description ) {
-        PA_IDXSET_FOREACH(iterator, u->core->source_outputs, index)
-        {
-            const char* proplist_description = pa_proplist_gets(iterator->proplist, PA_PROP_MEDIA_NAME);
-            if ( (proplist_description != NULL) && !(strcmp(Loopback_description, proplist_description)) ) {
-                pulse_source_output = iterator;
-                break;
-            }
-        }
-    }
-    return pulse_source_output;
-}
-
-/**
- * @brief This function returns the sink output pointer from the pulseaudio description.
- * @param: u: The user data pointer.
- *         description: The pulseaudio description property.
- * @return pa_sink_input*: The pointer to the pulse audio sink input.
- */
-static pa_sink_input* pulse_description_to_loopbacked_sink_input(const struct userdata* u, const char *description) {
-    pa_sink_input* pulse_sink_input = NULL;
-    pa_sink_input* iterator;
-    uint32_t index;
-    char Loopback_description[1024];
-    sprintf(Loopback_description, "Loopback from %s", description);
-    if ( description ) {
-        PA_IDXSET_FOREACH(iterator, u->core->sink_inputs, index)
-        {
-            const char* proplist_description = pa_proplist_gets(iterator->proplist, PA_PROP_MEDIA_NAME);
-            if ( (proplist_description != NULL) && !(strcmp(Loopback_description, proplist_description)) ) {
-                pulse_sink_input = iterator;
-                break;
-            }
-        }
-    }
-    return pulse_sink_input;
-}
-
-/**
- * @brief This function returns the pulseaudio module pointer from the source and sink id.
+ * @brief This function returns the loopback module which was loaded for a connection.
  * @param: u: The user data pointer.
- *         source_id: The source id.
- *         sink_id: The sink id.
- * @return pa_module*: The pointer to the pulse audio loopback module.
+ *         conn_data: The connection.
+ * @return pa_module*: The pointer to the pulse audio loopback module, NULL if the connection has none.
  */
-static pa_module* get_loopback_module(struct userdata *u, uint16_t source_id, uint16_t sink_id) {
+static pa_module* get_loopback_module(struct userdata *u, const am_connect_t *conn_data) {
     pa_module* loopback_module = NULL;
-    void* map_source_id;
-    void* map_sink_id;
-    void* state;
-    char* description = id_to_pulse_description(source_id, u->source_map);
-    pa_sink_input* sink_input = pulse_description_to_loopbacked_sink_input(u, description);
-    description = id_to_pulse_description(sink_id, u->sink_map);
-    pa_source_output* source_output = pulse_description_to_loopbacked_source_output(u, description);
-    if ( sink_input && source_output ) {
-        if ( sink_input->module == source_output->module ) {
-            loopback_module = sink_input->module;
-        }
+    if ( (conn_data != NULL) && (conn_data->loopback_module_index != PA_INVALID_INDEX) ) {
+        loopback_module = pa_idxset_get_by_index(u->core->modules, conn_data->loopback_module_index);
     }
     return loopback_module;
 }
@@ -589,8 +465,8 @@ static pa_module* get_loopback_module(struct userdata *u, uint16_t source_id, ui
  */
 static pa_module* load_loopback_module(struct userdata*u, uint16_t source_id, uint16_t sink_id) {
     pa_module* loopback_module = NULL;
-    char* source_name = id_to_am_name(source_id, u->source_map);
-    char* sink_name = id_to_am_name(sink_id, u->sink_map);
+    const char* source_name = id_to_am_name(source_id, &u->source_map);
+    const char* sink_name = id_to_am_name(sink_id, &u->sink_map);
     char arguments[1024];
 
     if ( false == pa_module_exists("module-loopback") ) {
@@ -600,7 +476,7 @@ static pa_module* load_loopback_module(struct userdata*u, uint16_t source_id, ui
         loopback_module = pa_module_load(u->core, "module-loopback", arguments);
         if ( loopback_module != NULL ) {
             // get the sink input connected to the sink
-            pa_sink_input* sink_input = am_id_to_loopbacked_sink_input(u, sink_id);
+            pa_sink_input* sink_input = am_id_to_loopbacked_sink_input(u, sink_id, loopback_module);
             if ( sink_input != NULL ) {
                 pa_sink_input_cork(sink_input, true);
             }
@@ -757,29 +633,14 @@ static void set_pa_volume(pa_cvolume* destchannelVolume, int num_channels, uint3
 }
 
 /**
- * @brief The hook/callback function called from the pulseaudio main loop whenever any sink_input is connected
- * to a sink.
- * @param: c: The pointer to pulseaudio core.
- *         sink_input: The sink input pointer.
- *         u: The pointer to the user data.
- * @return pa_hook_result: The result of the hook function.
+ * @brief This function connects a sink input to its audiomanager source, either by moving it to the sink of an
+ * existing connection or by sending the connect request to the audiomanager.
+ * @param: u: The pointer to the user data.
+ *         sink_input: The sink input pointer, already muted and corked.
+ * @return void
  */
-static pa_hook_result_t hook_callback_sink_input_put(pa_core *c, pa_sink_input *sink_input, struct userdata *u) {
-    pa_log_info("hook_callback_sink_input_put index=%d",sink_input->index);
-    pa_assert(c);
-    pa_assert(u);
-    pa_assert(sink_input);
-    bool corked = false;
-    pa_sink_input_state_t state;
-
-    if(true == is_stream_for_probe(sink_input->proplist))
-    {
-    	return PA_HOOK_OK;
-    }
-
-    pa_sink_input_set_mute(sink_input, true, false);
-    pa_sink_input_cork(sink_input, true);
-
+static void route_sink_input(struct userdata *u, pa_sink_input *sink_input) {
+    ROUTER_FUNCTION_ENTRY;
     char source_name[AM_MAX_NAME_LENGTH];
     memset(source_name,0,sizeof(source_name));
     get_am_name_for_sink_source_stream(sink_input->proplist,source_name);
@@ -788,17 +649,17 @@ static pa_hook_result_t hook_callback_sink_input_put(pa_core *c, pa_sink_input *
     memset(sink_name,0,sizeof(sink_name));
     get_am_name_from_device_description(sink_input->sink->proplist,sink_name);
 
-    pa_log_debug("hook_callback_sink_input_put source Name=%s sink_name=%s", source_name, sink_name);
+    pa_log_debug("route_sink_input source Name=%s sink_name=%s", source_name, sink_name);
 
-    uint16_t source_id = am_name_to_id(source_name, u->source_map);
-    uint16_t sink_id = am_name_to_id(sink_name, u->sink_map);
-    int source_index = get_map_index_from_id(source_id, u->source_map);
+    uint16_t source_id = am_name_to_id(source_name, &u->source_map);
+    uint16_t sink_id = am_name_to_id(sink_name, &u->sink_map);
+    int source_index = get_map_index_from_id(source_id, &u->source_map);
     if ( source_index != -1 ) {
-        u->source_map[source_index].data = (void*) sink_input;
+        router_map_set_data(&u->source_map, source_index, (void*) sink_input);
         /* set the sink input volume */
-        if ( ((u->source_map[source_index].builtin == false)) && (u->source_map[source_index].volume_valid == true) ) {
+        if ( ((u->source_map.builtin[source_index] == false)) && (u->source_map.entry[source_index].volume_valid == true) ) {
             pa_cvolume channelVolume;
-            set_pa_volume(&channelVolume, sink_input->volume.channels, (uint32_t) (u->source_map[source_index].volume));
+            set_pa_volume(&channelVolume, sink_input->volume.channels, (uint32_t) (u->source_map.entry[source_index].volume));
             pa_sink_input_set_volume(sink_input, &channelVolume, false, false);
         }
 
@@ -818,7 +679,7 @@ static pa_hook_result_t hook_callback_sink_input_put(pa_core *c, pa_sink_input *
          * 3. start playing if connection state changed to CS_CONNECTED.
          */
 #if 0
-            if ( u->source_map[source_index].source_state == SS_ON ) {
+            if ( u->source_map.source_state[source_index] == SS_ON ) {
                 if ( sink_input->muted == true ) {
                     pa_sink_input_set_mute(sink_input, false, false);
                 }
@@ -832,20 +693,20 @@ static pa_hook_result_t hook_callback_sink_input_put(pa_core *c, pa_sink_input *
         //Check if the source is connected to any other sink then the requested one in put request.
         am_connect_t* con = get_connection_from_source(u, source_id);
         if ( con != NULL ) {
-            int sink_index = get_map_index_from_id(con->sink_id, u->sink_map);
+            int sink_index = get_map_index_from_id(con->sink_id, &u->sink_map);
             if ( sink_index != -1 ) {
-                pa_sink* sink = (pa_sink*) (u->sink_map[sink_index].data);
+                pa_sink* sink = (pa_sink*) (u->sink_map.data[sink_index]);
                 if ( sink != NULL ) {
                     int return_code = pa_sink_input_move_to(sink_input, sink, false);
                     pa_log_debug("sink Input move return=%d", return_code);
                 }
-                if ( u->source_map[source_index].source_state == SS_ON ) {
+                if ( u->source_map.source_state[source_index] == SS_ON ) {
                     pa_sink_input_set_mute(sink_input, false, false);
                     pa_sink_input_cork(sink_input, false);
                 }
                 pa_log_info("connection already present moving to new");
                 ROUTER_FUNCTION_EXIT;
-                return PA_HOOK_OK;
+                return;
             }
         }
     }
@@ -863,9 +724,12 @@ static pa_hook_result_t hook_callback_sink_input_put(pa_core *c, pa_sink_input *
             memset(description, 0, sizeof(description));
             sscanf(source_name, "Loopback#from#%s", description);
             pa_log_debug("Loopback from -> %s", description);
-            connection_data.source_id = pulse_description_to_am_id(description, u->source_map);
+            connection_data.source_id = pulse_description_to_am_id(description, &u->source_map);
             pa_log_debug("source id =  %d", connection_data.source_id);
-            pa_source* source = am_name_to_pa_source(u, id_to_am_name(connection_data.source_id, u->source_map));
+            pa_source* source = NULL;
+            if ( is_source_sink_builtin(connection_data.source_id, &u->source_map) ) {
+                source = (pa_source*) get_pa_pointer_from_id(connection_data.source_id, &u->source_map);
+            }
             if ( source != NULL ) {
                 pa_source_suspend(source, true, PA_SUSPEND_INTERNAL);
             }
@@ -882,9 +746,270 @@ static pa_hook_result_t hook_callback_sink_input_put(pa_core *c, pa_sink_input *
     print_maps(u);
 #endif
     ROUTER_FUNCTION_EXIT;
+}
+
+/**
+ * @brief This function frees a source admission record.
+ * @param: p: The pointer to the router_admission.
+ * @return void
+ */
+static void admission_free(void *p) {
+    router_admission *admission = (router_admission*) p;
+    pa_idxset_free(admission->streams, NULL);
+    pa_xfree(admission->name);
+    pa_xfree(admission);
+}
+
+/**
+ * @brief This function creates a pending admission for a source/sink name.
+ * @param: admissions: The hash map of the pending admissions.
+ *         name: The audiomanager name.
+ * @return void
+ */
+static void admission_new(pa_hashmap *admissions, const char *name) {
+    router_admission *admission = pa_xnew0(router_admission, 1);
+    admission->name = pa_xstrdup(name);
+    admission->streams = pa_idxset_new(NULL, NULL);
+    pa_hashmap_put(admissions, admission->name, admission);
+}
+
+/**
+ * @brief This function completes the admission of a source, the sink inputs which were put while the
+ * audiomanager was being asked are routed now.
+ * @param: u: The pointer to the user data.
+ *         name: The audiomanager name of the source.
+ * @return void
+ */
+static void source_admission_finish(struct userdata *u, const char *name) {
+    router_admission *admission;
+    pa_sink_input *sink_input;
+
+    admission = (router_admission*) pa_hashmap_remove(u->source_admissions, name);
+    if ( admission == NULL ) {
+        return;
+    }
+    pa_log_debug("admission of source %s finished", admission->name);
+    while ( (sink_input = pa_idxset_steal_first(admission->streams, NULL)) != NULL ) {
+        route_sink_input(u, sink_input);
+    }
+    admission_free(admission);
+}
+
+/**
+ * @brief This function creates the map entry of an application source and registers it with the audiomanager.
+ * The admission is finished from the register reply, or right away if nothing was sent.
+ * @param: u: The pointer to the user data.
+ *         name: The audiomanager name of the source.
+ * @return void
+ */
+static void source_admission_register(struct userdata *u, const char *name) {
+    char source_name[AM_MAX_NAME_LENGTH];
+    bool already_present = false;
+    ROUTER_FUNCTION_ENTRY;
+
+    pa_strlcpy(source_name, name, sizeof(source_name));
+    int index = get_map_index_from_name(source_name, &u->source_map);
+    if ( index == -1 ) {
+        index = get_free_map_index(&u->source_map);
+        if ( index == -1 ) {
+            pa_log_error("no free source map entry for %s", source_name);
+            source_admission_finish(u, source_name);
+            ROUTER_FUNCTION_EXIT;
+            return;
+        }
+    }
+    already_present = (u->source_map.domain_id[index] == 0) ? false : true;
+    router_map_set_name(&u->source_map, index, source_name);
+    router_map_set_description(&u->source_map, index, source_name);
+    router_map_set_id(&u->source_map, index, 0);
+    u->source_map.builtin[index] = false;
+    router_map_set_data(&u->source_map, index, NULL);
+    if ( already_present == false ) {
+        am_source_register_t source_register;
+        memset(&source_register, 0, sizeof(am_source_register_t));
+        strncpy(source_register.name, source_name, AM_MAX_NAME_LENGTH);
+        source_register.domain_id = ((am_domain_register_t*) (u->domain))->domain_id;
+        source_register.availability_reason = 0;
+        source_register.available = A_AVAILABLE;
+        source_register.interrupt_state = 0;
+        source_register.source_class_id = 1;
+        source_register.source_id = 0;
+        source_register.source_state = SS_OFF;
+        source_register.visible = true;
+	/*
+         * For some reson this volume comes as zero so it gets translated to -3000
+         * presently hard code to 0
+         */
+        //int16_t audiomanagervolume;
+        //audiomanagervolume = ((0.04577706569008926527809567406729) * new_data->volume.values[0] ) - 3000;
+        source_register.volume = 100;
+	pa_log_info("source volume=%d",source_register.volume);
+        if ( router_dbusif_routing_register_source(u, &source_register) != 0 ) {
+            source_admission_finish(u, source_name);
+        }
+    } else {
+        source_admission_finish(u, source_name);
+    }
+    ROUTER_FUNCTION_EXIT;
+}
+
+/**
+ * @brief The hook/callback function called from the pulseaudio main loop whenever any sink_input is connected
+ * to a sink.
+ * @param: c: The pointer to pulseaudio core.
+ *         sink_input: The sink input pointer.
+ *         u: The pointer to the user data.
+ * @return pa_hook_result: The result of the hook function.
+ */
+static pa_hook_result_t hook_callback_sink_input_put(pa_core *c, pa_sink_input *sink_input, struct userdata *u) {
+    pa_log_info("hook_callback_sink_input_put index=%d",sink_input->index);
+    pa_assert(c);
+    pa_assert(u);
+    pa_assert(sink_input);
+    bool corked = false;
+    pa_sink_input_state_t state;
+
+    if(true == is_stream_for_probe(sink_input->proplist))
+    {
+    	return PA_HOOK_OK;
+    }
+
+    pa_sink_input_set_mute(sink_input, true, false);
+    pa_sink_input_cork(sink_input, true);
+
+    char source_name[AM_MAX_NAME_LENGTH];
+    memset(source_name,0,sizeof(source_name));
+    get_am_name_for_sink_source_stream(sink_input->proplist,source_name);
+
+    /* routing waits until the audiomanager has answered for the source */
+    router_admission *admission = pa_hashmap_get(u->source_admissions, source_name);
+    if ( admission != NULL ) {
+        pa_log_debug("source %s is not admitted yet, deferring sink input %d", source_name, sink_input->index);
+        pa_idxset_put(admission->streams, sink_input, NULL);
+        return PA_HOOK_OK;
+    }
+
+    route_sink_input(u, sink_input);
     return PA_HOOK_OK;
 }
 
+/**
+ * @brief This function sends the connect request for a source output to the audiomanager.
+ * @param: u: The pointer to the user data.
+ *         source_output: The source output pointer, already muted and corked.
+ * @return void
+ */
+static void route_source_output(struct userdata *u, pa_source_output *source_output) {
+    ROUTER_FUNCTION_ENTRY;
+    char sink_name[AM_MAX_NAME_LENGTH];
+    memset(sink_name,0,sizeof(sink_name));
+    get_am_name_for_sink_source_stream(source_output->proplist, sink_name);
+
+    am_main_connection_t connection_data;
+    connection_data.connection_id = 0;
+    //TODO : why this is hardcoded????
+    connection_data.source_id = am_name_to_id("Mic", &u->source_map);
+    connection_data.sink_id = am_name_to_id(sink_name, &u->sink_map);
+    connection_data.delay = 0;
+    connection_data.state = 0;
+    if ( (connection_data.source_id != 0) && (connection_data.sink_id != 0) ) {
+        int index = get_map_index_from_id(connection_data.sink_id, &u->sink_map);
+        if ( index != -1 ) {
+            router_map_set_data(&u->sink_map, index, source_output);
+        }
+        router_dbusif_command_connect(u, &connection_data);
+    }
+#if MODULE_ROUTER_EXTRA_LOGS
+    print_maps(u);
+#endif
+    ROUTER_FUNCTION_EXIT;
+}
+
+/**
+ * @brief This function completes the admission of a sink, the source outputs which were put while the
+ * audiomanager was being asked are routed now.
+ * @param: u: The pointer to the user data.
+ *         name: The audiomanager name of the sink.
+ * @return void
+ */
+static void sink_admission_finish(struct userdata *u, const char *name) {
+    router_admission *admission;
+    pa_source_output *source_output;
+
+    admission = (router_admission*) pa_hashmap_remove(u->sink_admissions, name);
+    if ( admission == NULL ) {
+        return;
+    }
+    pa_log_debug("admission of sink %s finished", admission->name);
+    while ( (source_output = pa_idxset_steal_first(admission->streams, NULL)) != NULL ) {
+        route_source_output(u, source_output);
+    }
+    admission_free(admission);
+}
+
+/**
+ * @brief This function creates the map entry of an application sink and registers it with the audiomanager.
+ * The admission is finished from the register reply, or right away if nothing was sent.
+ * @param: u: The pointer to the user data.
+ *         name: The audiomanager name of the sink.
+ * @return void
+ */
+static void sink_admission_register(struct userdata *u, const char *name) {
+    char sink_name[AM_MAX_NAME_LENGTH];
+    bool already_present = false;
+    ROUTER_FUNCTION_ENTRY;
+
+    pa_strlcpy(sink_name, name, sizeof(sink_name));
+    int index = get_map_index_from_name(sink_name, &u->sink_map);
+    if ( index == -1 ) {
+        index = get_free_map_index(&u->sink_map);
+        if ( index == -1 ) {
+            pa_log_error("no free sink map entry for %s", sink_name);
+            sink_admission_finish(u, sink_name);
+            ROUTER_FUNCTION_EXIT;
+            return;
+        }
+    }
+    already_present = (u->sink_map.domain_id[index] == 0) ? false : true;
+    router_map_set_name(&u->sink_map, index, sink_name);
+    router_map_set_description(&u->sink_map, index, sink_name);
+    router_map_set_id(&u->sink_map, index, 0);
+    u->sink_map.builtin[index] = false;
+    router_map_set_data(&u->sink_map, index, NULL);
+    if ( already_present == false ) {
+        am_sink_register_t sink_register;
+        memset(&sink_register, 0, sizeof(am_sink_register_t));
+        strncpy(sink_register.name, sink_name, AM_MAX_NAME_LENGTH);
+        sink_register.domain_id = ((am_domain_register_t*) (u->domain))->domain_id;
+        sink_register.availability_reason = 0;
+        sink_register.available = A_AVAILABLE;
+        sink_register.main_volume = 100;
+        sink_register.sink_class_id = 1;
+        sink_register.mute_state = 2;
+        sink_register.mute_state = SS_OFF;
+        sink_register.sink_id = 0;
+        sink_register.visible = true;
+	/*
+         * For some reson this volume comes as zero so it gets translated to -3000
+         * presently hard code to 0
+         */
+        //int16_t audiomanagervolume;
+        //audiomanagervolume = ((0.04577706569008926527809567406729) * new_data->volume.values[0] ) - 3000;
+        sink_register.volume = 0;
+       /*
+        * Convert the range [0-100] -> [0-65535]
+        */
+        sink_register.main_volume = 100;//new_data->volume.values[0] * 100 / 65535;
+        pa_log_info("sink volume=%d , main_volume=%d",sink_register.volume,sink_register.main_volume );
+        if ( router_dbusif_routing_register_sink(u, &sink_register) != 0 ) {
+            sink_admission_finish(u, sink_name);
+        }
+    } else {
+        sink_admission_finish(u, sink_name);
+    }
+    ROUTER_FUNCTION_EXIT;
+}
+
 /**
  * @brief The hook/callback function called from the pulseaudio main loop whenever any source_output is connected
  * to a source.
@@ -917,24 +1042,15 @@ static pa_hook_result_t hook_callback_source_output_put(pa_core *c, pa_source_ou
             pa_source_output_cork(source_output, true);
         }
 
-        am_main_connection_t connection_data;
-        connection_data.connection_id = 0;
-        //TODO : why this is hardcoded????
-        connection_data.source_id = am_name_to_id("Mic", u->source_map);
-        connection_data.sink_id = am_name_to_id(sink_name, u->sink_map);
-        connection_data.delay = 0;
-        connection_data.state = 0;
-        if ( (connection_data.source_id != 0) && (connection_data.sink_id != 0) ) {
-            int index = get_map_index_from_id(connection_data.sink_id, u->sink_map);
-            if ( index != -1 ) {
-                u->sink_map[index].data = source_output;
-            }
-            router_dbusif_command_connect(u, &connection_data);
+        /* routing waits until the audiomanager has answered for the sink */
+        router_admission *admission = pa_hashmap_get(u->sink_admissions, sink_name);
+        if ( admission != NULL ) {
+            pa_log_debug("sink %s is not admitted yet, deferring source output %d", sink_name, source_output->index);
+            pa_idxset_put(admission->streams, source_output, NULL);
+        } else {
+            route_source_output(u, source_output);
         }
     }
-#if MODULE_ROUTER_EXTRA_LOGS
-    print_maps(u);
-#endif
     ROUTER_FUNCTION_EXIT;
     return PA_HOOK_OK;
 }
@@ -963,36 +1079,31 @@ static pa_hook_result_t hook_callback_sink_input_unlink(pa_core *c, pa_sink_inpu
     char source_name[AM_MAX_NAME_LENGTH];
     memset(source_name,0,sizeof(source_name));
     get_am_name_for_sink_source_stream(sink_input->proplist,source_name);
-    uint16_t source_id = get_id_from_sink_input(sink_input, u->source_map);
+    router_admission *admission = pa_hashmap_get(u->source_admissions, source_name);
+    if ( admission != NULL ) {
+        pa_idxset_remove_by_data(admission->streams, sink_input, NULL);
+    }
+    uint16_t source_id = get_id_from_pa_pointer(sink_input, &u->source_map);
     pa_log_debug("source name = %s source id: %d", source_name, source_id);
     if ((source_name != NULL) && (source_id == 0) && strstr(source_name, "Loopback from") != NULL ) {
         char description[256];
         memset(description, 0, sizeof(description));
         sscanf(source_name, "Loopback from %s", description);
-        source_id = pulse_description_to_am_id(description, u->source_map);
+        source_id = pulse_description_to_am_id(description, &u->source_map);
     }
 
     /*
      * send disconnect request to the Audiomanager.
      */
-    am_main_connection_t* conn;
-    void *s;
-    bool found = false;
-    PA_HASHMAP_FOREACH(conn, u->main_connection_map, s)
-    {
-        if ( conn->source_id == source_id ) {
-            found = true;
-            break;
-        }
-    }
-    if ( found ) {
+    am_main_connection_t* conn = router_connection_get_by_source(u->main_connection_map, source_id);
+    if ( conn != NULL ) {
         am_disconnect_t disconnectData;
         disconnectData.connection_id = conn->connection_id;
         router_dbusif_command_disconnect(u, &disconnectData);
     }
-    int source_index = get_map_index_from_id(source_id, u->source_map);
-    if ( (source_index != -1) && (u->source_map[source_index].builtin == false) ) {
-        remove_pa_pointer(source_id, u->source_map);
+    int source_index = get_map_index_from_id(source_id, &u->source_map);
+    if ( (source_index != -1) && (u->source_map.builtin[source_index] == false) ) {
+        remove_pa_pointer(source_id, &u->source_map);
     }
 #if MODULE_ROUTER_EXTRA_LOGS
     print_maps(u);
@@ -1022,25 +1133,23 @@ static pa_hook_result_t hook_callback_source_output_unlink(pa_core *c, pa_source
     pa_log_debug("hook_callback_source_output_unlink sink name = %s", sink_name);
 
     if ( strstr(sink_name, "Loopback to") == NULL ) {
-        uint16_t sink_id = am_name_to_id(sink_name, u->sink_map);
-        am_main_connection_t* conn;
-        void *s;
-        bool found = false;
-        PA_HASHMAP_FOREACH(conn, u->main_connection_map, s)
-        {
-            if ( conn->sink_id == sink_id ) {
-                found = true;
-                break;
-            }
+        router_admission *admission = pa_hashmap_get(u->sink_admissions, sink_name);
+        if ( admission != NULL ) {
+            pa_idxset_remove_by_data(admission->streams, source_output, NULL);
+        }
+        uint16_t sink_id = get_id_from_pa_pointer(source_output, &u->sink_map);
+        if ( sink_id == 0 ) {
+            sink_id = am_name_to_id(sink_name, &u->sink_map);
         }
-        if ( found ) {
+        am_main_connection_t* conn = router_connection_get_by_sink(u->main_connection_map, sink_id);
+        if ( conn != NULL ) {
             am_disconnect_t disconnectData;
             disconnectData.connection_id = conn->connection_id;
             router_dbusif_command_disconnect(u, &disconnectData);
         }
-        int sink_index = get_map_index_from_id(sink_id, u->sink_map);
-        if ( (sink_index != -1) && (u->sink_map[sink_index].builtin == false) ) {
-            remove_pa_pointer(sink_id, u->sink_map);
+        int sink_index = get_map_index_from_id(sink_id, &u->sink_map);
+        if ( (sink_index != -1) && (u->sink_map.builtin[sink_index] == false) ) {
+            remove_pa_pointer(sink_id, &u->sink_map);
         }
     }
 #if MODULE_ROUTER_EXTRA_LOGS
@@ -1059,7 +1168,7 @@ static pa_hook_result_t register_sink_new(pa_core *c, pa_proplist* proplist, pa_
     memset(&sink_register, 0, sizeof(am_sink_register_t));
     get_am_name_from_device_description(proplist,sink_register.name);
 
-    if ( 0 == am_name_to_id(sink_register.name, u->sink_map) ) {
+    if ( 0 == am_name_to_id(sink_register.name, &u->sink_map) ) {
         pa_log_debug("sink Name=%s", sink_register.name);
         sink_register.domain_id = ((am_domain_register_t*) u->domain)->domain_id;
         sink_register.available = A_AVAILABLE;
@@ -1068,13 +1177,13 @@ static pa_hook_result_t register_sink_new(pa_core *c, pa_proplist* proplist, pa_
         sink_register.mute_state = SS_OFF;
         sink_register.sink_id = 0;
         sink_register.visible = true;
-        int index = get_free_map_index(u->sink_map);
+        int index = get_free_map_index(&u->sink_map);
         if ( index != -1 ) {
-            strncpy(u->sink_map[index].name, sink_register.name, AM_MAX_NAME_LENGTH);
-            strncpy(u->sink_map[index].description, sink_register.name, AM_MAX_NAME_LENGTH);
-            u->sink_map[index].id = 0;
-            u->sink_map[index].builtin = true;
-            u->sink_map[index].data = sink;
+            router_map_set_name(&u->sink_map, index, sink_register.name);
+            router_map_set_description(&u->sink_map, index, sink_register.name);
+            router_map_set_id(&u->sink_map, index, 0);
+            u->sink_map.builtin[index] = true;
+            router_map_set_data(&u->sink_map, index, sink);
             int16_t audiomanagervolume;
             audiomanagervolume = ((0.04577706569008926527809567406729) * sink_volume->values[0] ) - 3000;
             sink_register.volume = audiomanagervolume;
@@ -1124,7 +1233,7 @@ static pa_hook_result_t register_source_new(pa_core *c, pa_proplist* proplist, p
 
     memset(&source_register, 0, sizeof(am_source_register_t));
     get_am_name_from_device_description(proplist,source_register.name);
-    if ( 0 != am_name_to_id(source_register.name, u->source_map) ) {
+    if ( 0 == am_name_to_id(source_register.name, &u->source_map) ) {
         pa_log_debug("source name=%s", source_register.name);
         source_register.domain_id = ((am_domain_register_t*) (u->domain))->domain_id;
         source_register.availability_reason = 0;
@@ -1134,13 +1243,13 @@ static pa_hook_result_t register_source_new(pa_core *c, pa_proplist* proplist, p
         source_register.source_id = 0;
         source_register.source_state = SS_OFF;
         source_register.visible = true;
-        int index = get_free_map_index(u->source_map);
+        int index = get_free_map_index(&u->source_map);
         if ( index != -1 ) {
-            strncpy(u->source_map[index].name, source_register.name, AM_MAX_NAME_LENGTH);
-            strncpy(u->source_map[index].description, source_register.name, AM_MAX_NAME_LENGTH);
-            u->source_map[index].id = 0;
-            u->source_map[index].builtin = true;
-            u->source_map[index].data = source;
+            router_map_set_name(&u->source_map, index, source_register.name);
+            router_map_set_description(&u->source_map, index, source_register.name);
+            router_map_set_id(&u->source_map, index, 0);
+            u->source_map.builtin[index] = true;
+            router_map_set_data(&u->source_map, index, source);
             int16_t audiomanagervolume;
             audiomanagervolume = ((0.04577706569008926527809567406729) * source_volume->values[0] ) - 3000;
             source_register.volume = source_volume->values[0];
@@ -1176,6 +1285,110 @@ static pa_hook_result_t hook_callback_source_new(pa_core *c, pa_source_new_data*
     return PA_HOOK_OK;
 }
 
+/**
+ * @brief The hook/callback function called from the pulseaudio main loop whenever a sink is put. Builtin sinks are
+ * registered from the fixate hook before the pa_sink exists, this binds the sink to its map entry and applies the
+ * volume the audiomanager requested in the meantime.
+ * @param: c: The pointer to pulseaudio core.
+ *         sink: The sink pointer.
+ *         u: The pointer to the user data.
+ * @return pa_hook_result: The result of the hook function.
+ */
+static pa_hook_result_t hook_callback_sink_put(pa_core *c, pa_sink *sink, struct userdata *u) {
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(c);
+    pa_assert(sink);
+    pa_assert(u);
+
+    char sink_name[AM_MAX_NAME_LENGTH];
+    memset(sink_name,0,sizeof(sink_name));
+    get_am_name_from_device_description(sink->proplist,sink_name);
+    int index = get_map_index_from_name(sink_name, &u->sink_map);
+    if ( (index != -1) && (u->sink_map.builtin[index] == true) ) {
+        router_map_set_data(&u->sink_map, index, sink);
+        if ( u->sink_map.entry[index].volume_valid == true ) {
+            pa_cvolume channelVolume;
+            set_pa_volume(&channelVolume, sink->soft_volume.channels, (uint32_t) (u->sink_map.entry[index].volume));
+            pa_sink_set_volume(sink, &channelVolume, false, false);
+        }
+    }
+    ROUTER_FUNCTION_EXIT;
+    return PA_HOOK_OK;
+}
+
+/**
+ * @brief The hook/callback function called from the pulseaudio main loop whenever a sink is unlinked.
+ * @param: c: The pointer to pulseaudio core.
+ *         sink: The sink pointer.
+ *         u: The pointer to the user data.
+ * @return pa_hook_result: The result of the hook function.
+ */
+static pa_hook_result_t hook_callback_sink_unlink(pa_core *c, pa_sink *sink, struct userdata *u) {
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(c);
+    pa_assert(sink);
+    pa_assert(u);
+
+    int index = router_map_index_from_data(&u->sink_map, sink);
+    if ( index != -1 ) {
+        router_map_set_data(&u->sink_map, index, NULL);
+    }
+    ROUTER_FUNCTION_EXIT;
+    return PA_HOOK_OK;
+}
+
+/**
+ * @brief The hook/callback function called from the pulseaudio main loop whenever a source is put. Builtin sources
+ * are registered from the fixate hook before the pa_source exists, this binds the source to its map entry and applies
+ * the volume and state the audiomanager requested in the meantime.
+ * @param: c: The pointer to pulseaudio core.
+ *         source: The source pointer.
+ *         u: The pointer to the user data.
+ * @return pa_hook_result: The result of the hook function.
+ */
+static pa_hook_result_t hook_callback_source_put(pa_core *c, pa_source *source, struct userdata *u) {
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(c);
+    pa_assert(source);
+    pa_assert(u);
+
+    char source_name[AM_MAX_NAME_LENGTH];
+    memset(source_name,0,sizeof(source_name));
+    get_am_name_from_device_description(source->proplist,source_name);
+    int index = get_map_index_from_name(source_name, &u->source_map);
+    if ( (index != -1) && (u->source_map.builtin[index] == true) ) {
+        router_map_set_data(&u->source_map, index, source);
+        if ( u->source_map.entry[index].volume_valid == true ) {
+            pa_cvolume channelVolume;
+            set_pa_volume(&channelVolume, source->real_volume.channels, (uint32_t) (u->source_map.entry[index].volume));
+            pa_source_set_volume(source, &channelVolume, false, false);
+        }
+    }
+    ROUTER_FUNCTION_EXIT;
+    return PA_HOOK_OK;
+}
+
+/**
+ * @brief The hook/callback function called from the pulseaudio main loop whenever a source is unlinked.
+ * @param: c: The pointer to pulseaudio core.
+ *         source: The source pointer.
+ *         u: The pointer to the user data.
+ * @return pa_hook_result: The result of the hook function.
+ */
+static pa_hook_result_t hook_callback_source_unlink(pa_core *c, pa_source *source, struct userdata *u) {
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(c);
+    pa_assert(source);
+    pa_assert(u);
+
+    int index = router_map_index_from_data(&u->source_map, source);
+    if ( index != -1 ) {
+        router_map_set_data(&u->source_map, index, NULL);
+    }
+    ROUTER_FUNCTION_EXIT;
+    return PA_HOOK_OK;
+}
+
 /**
  * @brief The hook/callback function called from the pulseaudio main loop whenever any sink input appears in the
  * system.
@@ -1189,8 +1402,6 @@ static pa_hook_result_t hook_callback_source_new(pa_core *c, pa_source_new_data*
 static pa_hook_result_t hook_callback_sink_input_new(pa_core *c, pa_sink_input_new_data *new_data, struct userdata *u) {
     ROUTER_FUNCTION_ENTRY;
 
-    bool already_present = false;
-
     pa_assert(c);
     pa_assert(new_data);
     pa_assert(u);
@@ -1203,7 +1414,7 @@ static pa_hook_result_t hook_callback_sink_input_new(pa_core *c, pa_sink_input_n
     char source_name[AM_MAX_NAME_LENGTH];
     memset(source_name,0,sizeof(source_name));
     get_am_name_for_sink_source_stream(new_data->proplist,source_name);
-    if ( (source_name == NULL) || (0 != am_name_to_id(source_name, u->source_map))
+    if ( (source_name == NULL) || (0 != am_name_to_id(source_name, &u->source_map))
             || (NULL != strstr(source_name, "Loopback from")) ) {
 #if MODULE_ROUTER_EXTRA_LOGS
         print_maps(u);
@@ -1211,53 +1422,21 @@ static pa_hook_result_t hook_callback_sink_input_new(pa_core *c, pa_sink_input_n
         ROUTER_FUNCTION_EXIT;
         return PA_HOOK_OK;
     }
-    /* Peek and figure out if already registered */
-    router_dbusif_routing_peek_source(u, source_name);
-    if ( 0 != am_name_to_id(source_name, u->source_map) ) {
-        router_dbusif_get_domain_of_source(u, am_name_to_id(source_name, u->source_map));
-        if ( u->source_map[get_map_index_from_name(source_name, u->source_map)].domain_id != 0 ) {
-#if MODULE_ROUTER_EXTRA_LOGS
-            print_maps(u);
-#endif
-            ROUTER_FUNCTION_EXIT;
-            return PA_HOOK_OK;
-        }
+    /* an admission is already pending for this source, its reply routes the stream as well */
+    if ( pa_hashmap_get(u->source_admissions, source_name) != NULL ) {
+        new_data->flags |= PA_SINK_INPUT_START_CORKED;
+        ROUTER_FUNCTION_EXIT;
+        return PA_HOOK_OK;
     }
 
-    int index = get_map_index_from_name(source_name, u->source_map);
-    if ( index == -1 ) {
-        index = get_free_map_index(u->source_map);
-        u->source_map[index].id = 0;
-    }
-    if ( index != -1 ) {
-        already_present = (u->source_map[index].domain_id == 0) ? false : true;
+    admission_new(u->source_admissions, source_name);
+
+    /* Peek and figure out if already registered, the reply continues the admission */
+    if ( router_dbusif_routing_peek_source(u, source_name) != 0 ) {
+        source_admission_register(u, source_name);
     }
-    strncpy(u->source_map[index].name, source_name, AM_MAX_NAME_LENGTH);
-    strncpy(u->source_map[index].description, source_name, AM_MAX_NAME_LENGTH);
-    u->source_map[index].id = 0;
-    u->source_map[index].builtin = false;
-    u->source_map[index].data = NULL;
-    if ( already_present == false ) {
-        am_source_register_t source_register;
-        memset(&source_register, 0, sizeof(am_source_register_t));
-        strncpy(source_register.name, source_name, AM_MAX_NAME_LENGTH);
-        source_register.domain_id = ((am_domain_register_t*) (u->domain))->domain_id;
-        source_register.availability_reason = 0;
-        source_register.available = A_AVAILABLE;
-        source_register.interrupt_state = 0;
-        source_register.source_class_id = 1;
-        source_register.source_id = 0;
-        source_register.source_state = SS_OFF;
-        source_register.visible = true;
-	/*
-         * For some reson this volume comes as zero so it gets translated to -3000
-         * presently hard code to 0
-         */
-        //int16_t audiomanagervolume;
-        //audiomanagervolume = ((0.04577706569008926527809567406729) * new_data->volume.values[0] ) - 3000;
-        source_register.volume = 100;
-	pa_log_info("source volume=%d",source_register.volume);
-        router_dbusif_routing_register_source(u, &source_register);
+    if ( pa_hashmap_get(u->source_admissions, source_name) != NULL ) {
+        new_data->flags |= PA_SINK_INPUT_START_CORKED;
     }
 
 #if MODULE_ROUTER_EXTRA_LOGS
@@ -1280,7 +1459,6 @@ static pa_hook_result_t hook_callback_sink_input_new(pa_core *c, pa_sink_input_n
 static pa_hook_result_t hook_callback_source_output_new(pa_core *c, pa_source_output_new_data* new_data,
         struct userdata *u) {
     ROUTER_FUNCTION_ENTRY;
-    bool already_present = false;
 
     pa_assert(c);
     pa_assert(new_data);
@@ -1288,7 +1466,7 @@ static pa_hook_result_t hook_callback_source_output_new(pa_core *c, pa_source_ou
     char sink_name[AM_MAX_NAME_LENGTH];
     memset(sink_name,0,sizeof(sink_name));
     get_am_name_for_sink_source_stream(new_data->proplist,sink_name);
-    if ( (sink_name == NULL) || (0 != am_name_to_id(sink_name, u->sink_map))
+    if ( (sink_name == NULL) || (0 != am_name_to_id(sink_name, &u->sink_map))
             || (NULL != strstr(sink_name, "Loopback from")) ) {
 #if MODULE_ROUTER_EXTRA_LOGS
         print_maps(u);
@@ -1296,60 +1474,21 @@ static pa_hook_result_t hook_callback_source_output_new(pa_core *c, pa_source_ou
         ROUTER_FUNCTION_EXIT;
         return PA_HOOK_OK;
     }
-    /* Peek and figure out if already registered */
-    router_dbusif_routing_peek_sink(u, sink_name);
-    if ( 0 != am_name_to_id(sink_name, u->sink_map) ) {
-        router_dbusif_get_domain_of_source(u, am_name_to_id(sink_name, u->sink_map));
-        if ( u->source_map[get_map_index_from_name(sink_name, u->sink_map)].domain_id != 0 ) {
-#if MODULE_ROUTER_EXTRA_LOGS
-            print_maps(u);
-#endif
-            ROUTER_FUNCTION_EXIT;
-            return PA_HOOK_OK;
-        }
+    /* an admission is already pending for this sink, its reply routes the stream as well */
+    if ( pa_hashmap_get(u->sink_admissions, sink_name) != NULL ) {
+        new_data->flags |= PA_SOURCE_OUTPUT_START_CORKED;
+        ROUTER_FUNCTION_EXIT;
+        return PA_HOOK_OK;
     }
 
-    int index = get_free_map_index(u->sink_map);
-    if ( index == -1 ) {
-        index = get_free_map_index(u->sink_map);
-        u->sink_map[index].id = 0;
-    }
-    if ( index != -1 ) {
-        already_present = (u->sink_map[index].domain_id == 0) ? false : true;
+    admission_new(u->sink_admissions, sink_name);
+
+    /* Peek and figure out if already registered, the reply continues the admission */
+    if ( router_dbusif_routing_peek_sink(u, sink_name) != 0 ) {
+        sink_admission_register(u, sink_name);
     }
-    strncpy(u->sink_map[index].name, sink_name, AM_MAX_NAME_LENGTH);
-    strncpy(u->sink_map[index].description, sink_name, AM_MAX_NAME_LENGTH);
-    u->sink_map[index].id = 0;
-    u->sink_map[index].builtin = false;
-    u->sink_map[index].data = NULL;
-    if ( already_present == false ) {
-        am_sink_register_t sink_register;
-        memset(&sink_register, 0, sizeof(am_sink_register_t));
-        strncpy(sink_register.name, sink_name, AM_MAX_NAME_LENGTH);
-        sink_register.domain_id = ((am_domain_register_t*) (u->domain))->domain_id;
-        sink_register.availability_reason = 0;
-        sink_register.available = A_AVAILABLE;
-        sink_register.main_volume = 100;
-        sink_register.sink_class_id = 1;
-        sink_register.mute_state = 2;
-        sink_register.mute_state = SS_OFF;
-        sink_register.sink_id = 0;
-        sink_register.visible = true;
-        strncpy(u->sink_map[index].name, sink_register.name, AM_MAX_NAME_LENGTH);
-        strncpy(u->sink_map[index].description, sink_register.name, AM_MAX_NAME_LENGTH);
-	/*
-         * For some reson this volume comes as zero so it gets translated to -3000
-         * presently hard code to 0
-         */
-        //int16_t audiomanagervolume;
-        //audiomanagervolume = ((0.04577706569008926527809567406729) * new_data->volume.values[0] ) - 3000;
-        sink_register.volume = 0;
-       /*
-        * Convert the range [0-100] -> [0-65535]
-        */
-        sink_register.main_volume = 100;//new_data->volume.values[0] * 100 / 65535;
-        pa_log_info("sink volume=%d , main_volume=%d",sink_register.volume,sink_register.main_volume );
-        router_dbusif_routing_register_sink(u, &sink_register);
+    if ( pa_hashmap_get(u->sink_admissions, sink_name) != NULL ) {
+        new_data->flags |= PA_SOURCE_OUTPUT_START_CORKED;
     }
 #if MODULE_ROUTER_EXTRA_LOGS
     print_maps(u);
@@ -1358,6 +1497,33 @@ static pa_hook_result_t hook_callback_source_output_new(pa_core *c, pa_source_ou
     return PA_HOOK_OK;
 }
 
+/**
+ * @brief The subscription callback called from the pulseaudio main loop whenever a module is loaded or unloaded.
+ * It forgets the loopback modules which were unloaded without a disconnect from the audiomanager.
+ * @param: c: The pointer to pulseaudio core.
+ *         t: The subscription event type.
+ *         idx: The index of the module.
+ *         userdata: The pointer to the user data.
+ * @return void
+ */
+static void subscription_callback_module(pa_core *c, pa_subscription_event_type_t t, uint32_t idx, void *userdata) {
+    struct userdata *u = userdata;
+    am_connect_t *conn_data;
+    void *s;
+    pa_assert(u);
+
+    if ( (t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) != PA_SUBSCRIPTION_EVENT_REMOVE ) {
+        return;
+    }
+    ROUTER_CONNECTION_FOREACH(conn_data, u->connection_map, s)
+    {
+        if ( conn_data->loopback_module_index == idx ) {
+            pa_log_info("loopback module %u of connection %d unloaded", idx, conn_data->connection_id);
+            conn_data->loopback_module_index = PA_INVALID_INDEX;
+        }
+    }
+}
+
 /**
  * @brief The function to register the source with audio manager.
  * @param: u: The pointer to the user data.
@@ -1416,8 +1582,11 @@ static void cb_command_connect_reply(struct userdata *u, int status, void* data)
     if ( (status == E_OK) && (main_connect_data->connection_id != 0) ) {
         am_main_connection_t* main_connect_data_map = pa_xmemdup(main_connect_data, sizeof(am_main_connection_t));
         pa_log_debug("adding connection with id = %d status=%d", main_connect_data->connection_id, status);
-        pa_hashmap_put(u->main_connection_map, (void*) (intptr_t) main_connect_data->connection_id,
-                main_connect_data_map);
+        if ( false == router_connection_put(u->main_connection_map, main_connect_data_map->connection_id,
+                main_connect_data_map->source_id, main_connect_data_map->sink_id, main_connect_data_map) ) {
+            pa_log_error("main connection id=%d already present", main_connect_data_map->connection_id);
+            pa_xfree(main_connect_data_map);
+        }
     }
 #if MODULE_ROUTER_EXTRA_LOGS
     print_maps(u);
@@ -1454,6 +1623,10 @@ static void cb_routing_register_domain_reply(struct userdata *u, int status, voi
 
     ((am_domain_register_t*) (u->domain))->domain_id = domain_register->domain_id;
     pa_log_debug("domainid=%d", domain_register->domain_id);
+    /*
+     * All the registrations are put in flight together, completion is reported once the last reply has landed
+     */
+    router_dbusif_registration_batch_begin(u);
     /*
      * Get the list of source and register each and every source
      */
@@ -1463,6 +1636,149 @@ static void cb_routing_register_domain_reply(struct userdata *u, int status, voi
      * Get the list of sink and register each and every sink
      */
     router_discover_register_sink(u);
+    router_dbusif_registration_batch_end(u);
+#if MODULE_ROUTER_EXTRA_LOGS
+    print_maps(u);
+#endif
+    ROUTER_FUNCTION_EXIT;
+}
+
+/**
+ * @brief The callback function from the dbus interface, called when all the registrations sent at domain startup
+ * have been answered.
+ * @param: u: The pointer to the user data.
+ *         count: The number of requests in the batch.
+ * @return void
+ */
+static void cb_routing_register_batch_done(struct userdata *u, uint32_t count) {
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
+
+    pa_log_info("startup registration done, %u requests answered", count);
+#if MODULE_ROUTER_EXTRA_LOGS
+    print_maps(u);
+#endif
+    ROUTER_FUNCTION_EXIT;
+}
+
+/**
+ * @brief This function invalidates the cached audiomanager id and domain of a source/sink map entry. Entries which
+ * nothing refers to anymore are recycled, the next stream asks the audiomanager again.
+ * @param: map: The pointer to the source/sink map.
+ *         index: The index of the entry.
+ * @return void
+ */
+static void invalidate_map_entry(router_map *map, int16_t index) {
+    if ( (map->builtin[index] == false) && (map->data[index] == NULL) ) {
+        router_map_release(map, index);
+    } else {
+        router_map_set_id(map, index, 0);
+        map->domain_id[index] = 0;
+    }
+}
+
+/**
+ * @brief This function drops everything the module learned from the audiomanager about its sources and sinks.
+ * Builtin entries are recycled as well, they are registered again once the domain is.
+ * @param: map: The pointer to the source/sink map.
+ * @return void
+ */
+static void flush_map(router_map *map) {
+    int16_t index;
+    for ( index = 0; index < map->size ; index++ ) {
+        if ( map->entry[index].in_use == false ) {
+            continue;
+        }
+        if ( map->builtin[index] == true ) {
+            router_map_release(map, index);
+        } else {
+            invalidate_map_entry(map, index);
+        }
+    }
+}
+
+/**
+ * @brief The callback function from the dbus interface, when the audiomanager signals a new sink. A cached entry
+ * of the same name takes over the announced id.
+ * @param: u: The pointer to the user data.
+ *         id: The id of the sink.
+ *         name: The name of the sink.
+ * @return void
+ */
+static void cb_new_sink(struct userdata *u, uint16_t id, const char *name) {
+    int16_t index = (name != NULL) ? get_map_index_from_name(name, &u->sink_map) : -1;
+    if ( (index != -1) && (u->sink_map.id[index] != id) ) {
+        pa_log_debug("sink %s re-registered with id %d", name, id);
+        router_map_set_id(&u->sink_map, index, id);
+        u->sink_map.domain_id[index] = 0;
+    }
+}
+
+/**
+ * @brief The callback function from the dbus interface, when the audiomanager signals a new source. A cached entry
+ * of the same name takes over the announced id.
+ * @param: u: The pointer to the user data.
+ *         id: The id of the source.
+ *         name: The name of the source.
+ * @return void
+ */
+static void cb_new_source(struct userdata *u, uint16_t id, const char *name) {
+    int16_t index = (name != NULL) ? get_map_index_from_name(name, &u->source_map) : -1;
+    if ( (index != -1) && (u->source_map.id[index] != id) ) {
+        pa_log_debug("source %s re-registered with id %d", name, id);
+        router_map_set_id(&u->source_map, index, id);
+        u->source_map.domain_id[index] = 0;
+    }
+}
+
+/**
+ * @brief The callback function from the dbus interface, when the audiomanager signals a removed sink.
+ * @param: u: The pointer to the user data.
+ *         id: The id of the sink.
+ *         name: unused.
+ * @return void
+ */
+static void cb_removed_sink(struct userdata *u, uint16_t id, const char *name) {
+    int16_t index = get_map_index_from_id(id, &u->sink_map);
+    if ( index != -1 ) {
+        pa_log_debug("sink id %d removed by the audiomanager", id);
+        invalidate_map_entry(&u->sink_map, index);
+    }
+}
+
+/**
+ * @brief The callback function from the dbus interface, when the audiomanager signals a removed source.
+ * @param: u: The pointer to the user data.
+ *         id: The id of the source.
+ *         name: unused.
+ * @return void
+ */
+static void cb_removed_source(struct userdata *u, uint16_t id, const char *name) {
+    int16_t index = get_map_index_from_id(id, &u->source_map);
+    if ( index != -1 ) {
+        pa_log_debug("source id %d removed by the audiomanager", id);
+        invalidate_map_entry(&u->source_map, index);
+    }
+}
+
+/**
+ * @brief The callback function from the dbus interface, when the audiomanager appears on or vanishes from the bus.
+ * The cached ids belong to the previous instance, they are dropped and the domain is registered again.
+ * @param: u: The pointer to the user data.
+ *         available: true if the audiomanager has a new owner on the bus.
+ * @return void
+ */
+static void cb_am_owner_changed(struct userdata *u, bool available) {
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
+
+    pa_log_info("audiomanager %s, flushing the cached ids", available ? "restarted" : "vanished");
+    flush_map(&u->source_map);
+    flush_map(&u->sink_map);
+    ((am_domain_register_t*) (u->domain))->domain_id = 0;
+    if ( available ) {
+        router_dbusif_routing_register_domain(u, (am_domain_register_t*) u->domain);
+    }
 #if MODULE_ROUTER_EXTRA_LOGS
     print_maps(u);
 #endif
@@ -1485,23 +1801,34 @@ static void cb_routing_peek_sink_reply(struct userdata *u, int status, void* dat
     pa_assert(sink);
 
     pa_log_info("sink name=%s", sink->name);
-    int index = am_name_to_map_index(sink->name, u->sink_map);
+    int index = am_name_to_map_index(sink->name, &u->sink_map);
     if ( status == E_OK ) {
-        int index = get_map_index_from_id(sink->sink_id, u->sink_map);
+        int index = get_map_index_from_id(sink->sink_id, &u->sink_map);
         if ( (index != -1) ) {
             pa_log_error("updating sink:%s id=%d", sink->name, sink->sink_id);
-            strncmp(u->sink_map[index].name, sink->name, AM_MAX_NAME_LENGTH);
+            router_map_set_name(&u->sink_map, index, sink->name);
         } else {
-            index = get_map_index_from_name(sink->name, u->sink_map);
+            index = get_map_index_from_name(sink->name, &u->sink_map);
             if ( index != -1 ) {
-                u->sink_map[index].id = sink->sink_id;
+                router_map_set_id(&u->sink_map, index, sink->sink_id);
             } else {
-                index = get_free_map_index(u->sink_map);
-                u->sink_map[index].id = sink->sink_id;
-                strncmp(u->sink_map[index].name, sink->name, AM_MAX_NAME_LENGTH);
+                index = get_free_map_index(&u->sink_map);
+                if ( index != -1 ) {
+                    router_map_set_id(&u->sink_map, index, sink->sink_id);
+                    router_map_set_name(&u->sink_map, index, sink->name);
+                }
             }
         }
     }
+    if ( pa_hashmap_get(u->sink_admissions, sink->name) != NULL ) {
+        if ( (status == E_OK) && (sink->sink_id != 0) ) {
+            if ( router_dbusif_get_domain_of_sink(u, sink->sink_id) != 0 ) {
+                sink_admission_register(u, sink->name);
+            }
+        } else {
+            sink_admission_register(u, sink->name);
+        }
+    }
 #if MODULE_ROUTER_EXTRA_LOGS
     print_maps(u);
 #endif
@@ -1525,22 +1852,33 @@ static void cb_routing_peek_source_reply(struct userdata *u, int status, void* d
 
     pa_log_debug("source name=%s id=%d", source->name, source->source_id);
     if ( status == E_OK ) {
-        int index = get_map_index_from_id(source->source_id, u->source_map);
+        int index = get_map_index_from_id(source->source_id, &u->source_map);
         if ( (index != -1) ) {
             pa_log_debug("updating source:%s id=%d", source->name, source->source_id);
-            strncpy(u->source_map[index].name, source->name, AM_MAX_NAME_LENGTH);
-            u->source_map[index].id = source->source_id;
+            router_map_set_name(&u->source_map, index, source->name);
+            router_map_set_id(&u->source_map, index, source->source_id);
         } else {
-            index = get_map_index_from_name(source->name, u->source_map);
+            index = get_map_index_from_name(source->name, &u->source_map);
             if ( index != -1 ) {
-                u->source_map[index].id = source->source_id;
-                u->source_map[index].source_state = SS_OFF;
+                router_map_set_id(&u->source_map, index, source->source_id);
+                u->source_map.source_state[index] = SS_OFF;
             } else {
-                index = get_free_map_index(u->source_map);
-                u->source_map[index].id = source->source_id;
-                strncpy(u->source_map[index].name, source->name, AM_MAX_NAME_LENGTH);
-                u->source_map[index].source_state = SS_OFF;
+                index = get_free_map_index(&u->source_map);
+                if ( index != -1 ) {
+                    router_map_set_id(&u->source_map, index, source->source_id);
+                    router_map_set_name(&u->source_map, index, source->name);
+                    u->source_map.source_state[index] = SS_OFF;
+                }
+            }
+        }
+    }
+    if ( pa_hashmap_get(u->source_admissions, source->name) != NULL ) {
+        if ( (status == E_OK) && (source->source_id != 0) ) {
+            if ( router_dbusif_get_domain_of_source(u, source->source_id) != 0 ) {
+                source_admission_register(u, source->name);
             }
+        } else {
+            source_admission_register(u, source->name);
         }
     }
 #if MODULE_ROUTER_EXTRA_LOGS
@@ -1564,9 +1902,18 @@ static void cb_routing_get_domain_of_sink(struct userdata *u, int status, void*
     pa_assert(sink);
 
     if ( status == E_OK ) {
-        int index = get_map_index_from_id(sink->id, u->sink_map);
+        int index = get_map_index_from_id(sink->id, &u->sink_map);
         if ( (index != -1) ) {
-            u->sink_map[index].domain_id = sink->domain_id;
+            u->sink_map.domain_id[index] = sink->domain_id;
+        }
+    }
+    const char *name = id_to_am_name(sink->id, &u->sink_map);
+    if ( (name != NULL) && (pa_hashmap_get(u->sink_admissions, name) != NULL) ) {
+        int16_t index = get_map_index_from_id(sink->id, &u->sink_map);
+        if ( u->sink_map.domain_id[index] != 0 ) {
+            sink_admission_finish(u, name);
+        } else {
+            sink_admission_register(u, name);
         }
     }
 #if MODULE_ROUTER_EXTRA_LOGS
@@ -1591,9 +1938,18 @@ static void cb_routing_get_domain_of_source(struct userdata *u, int status, void
     pa_assert(source);
 
     if ( status == E_OK ) {
-        int16_t index = get_map_index_from_id(source->id, u->source_map);
+        int16_t index = get_map_index_from_id(source->id, &u->source_map);
         if ( (index != -1) ) {
-            u->source_map[index].domain_id = source->domain_id;
+            u->source_map.domain_id[index] = source->domain_id;
+        }
+    }
+    const char *name = id_to_am_name(source->id, &u->source_map);
+    if ( (name != NULL) && (pa_hashmap_get(u->source_admissions, name) != NULL) ) {
+        int16_t index = get_map_index_from_id(source->id, &u->source_map);
+        if ( u->source_map.domain_id[index] != 0 ) {
+            source_admission_finish(u, name);
+        } else {
+            source_admission_register(u, name);
         }
     }
 #if MODULE_ROUTER_EXTRA_LOGS
@@ -1655,11 +2011,17 @@ static void cb_routing_register_source_reply(struct userdata *u, int status, voi
     pa_assert(source);
 
     pa_log_debug("cb_routing_register_source_reply source name=%s", source->name);
-    int index = am_name_to_map_index(source->name, u->source_map);
+    int index = am_name_to_map_index(source->name, &u->source_map);
     if ( (index != -1) && (status == E_OK) ) {
-        u->source_map[index].id = source->source_id;
+        router_map_set_id(&u->source_map, index, source->source_id);
         pa_log_error("updating source:%s id=%d", source->name, source->source_id);
+    } else if ( (index != -1) && (u->source_map.builtin[index] == false) && (u->source_map.id[index] == 0)
+            && (u->source_map.data[index] == NULL) ) {
+        /* nothing refers to an application source the audiomanager refused, recycle the entry. A builtin source has no
+         * data until it is put, its entry is kept. */
+        router_map_release(&u->source_map, index);
     }
+    source_admission_finish(u, source->name);
 #if MODULE_ROUTER_EXTRA_LOGS
     print_maps(u);
 #endif
@@ -1681,11 +2043,17 @@ static void cb_routing_register_sink_reply(struct userdata *u, int status, void*
     pa_assert(sink);
 
     pa_log_debug("cb_routing_register_source_reply sink name=%s", sink->name);
-    int index = am_name_to_map_index(sink->name, u->sink_map);
+    int index = am_name_to_map_index(sink->name, &u->sink_map);
     if ( (index != -1) && (status == E_OK) ) {
-        u->sink_map[index].id = sink->sink_id;
+        router_map_set_id(&u->sink_map, index, sink->sink_id);
         pa_log_error("updating sink:%s id=%d", sink->name, sink->sink_id);
+    } else if ( (index != -1) && (u->sink_map.builtin[index] == false) && (u->sink_map.id[index] == 0)
+            && (u->sink_map.data[index] == NULL) ) {
+        /* nothing refers to an application sink the audiomanager refused, recycle the entry. A builtin sink has no
+         * data until it is put, its entry is kept. */
+        router_map_release(&u->sink_map, index);
     }
+    sink_admission_finish(u, sink->name);
     ROUTER_FUNCTION_EXIT;
 }
 
@@ -1709,11 +2077,13 @@ static uint16_t cb_routing_async_connect(struct userdata *u, uint16_t handle, ui
     pa_assert(u);
     pa_assert(connection_id != 0);
 
-    int already_in_map = !!pa_hashmap_get(u->connection_map, (void*) (intptr_t) connection_id);
+    int already_in_map = !!router_connection_get(u->connection_map, connection_id);
     if ( !already_in_map ) {
-        if ( (true == is_source_sink_builtin(source_id, u->source_map))
-                && (true == is_source_sink_builtin(sink_id, u->sink_map)) ) {
-            loopback_module = get_loopback_module(u, source_id, sink_id);
+        if ( (true == is_source_sink_builtin(source_id, &u->source_map))
+                && (true == is_source_sink_builtin(sink_id, &u->sink_map)) ) {
+            /* reuse the loopback of another connection between the same source and sink */
+            loopback_module = get_loopback_module(u,
+                    router_connection_get_by_source_sink(u->connection_map, source_id, sink_id));
             if ( !loopback_module ) {
                 loopback_module = load_loopback_module(u, source_id, sink_id);
                 if ( loopback_module == NULL ) {
@@ -1728,7 +2098,8 @@ static uint16_t cb_routing_async_connect(struct userdata *u, uint16_t handle, ui
             conn_data->sink_id = sink_id;
             conn_data->connection_id = connection_id;
             conn_data->connection_format = format;
-            pa_hashmap_put(u->connection_map, (void*) (intptr_t) connection_id, conn_data);
+            conn_data->loopback_module_index = loopback_module ? loopback_module->index : PA_INVALID_INDEX;
+            router_connection_put(u->connection_map, connection_id, source_id, sink_id, conn_data);
         }
     } else {
         ack_status = E_NOT_POSSIBLE;
@@ -1759,14 +2130,15 @@ static uint16_t cb_routing_async_disconnect(struct userdata *u, uint16_t handle,
     pa_assert(u);
     pa_assert(connection_id != 0);
 
-    conn_data = pa_hashmap_get(u->connection_map, (void*) (intptr_t) connection_id);
+    conn_data = router_connection_remove(u->connection_map, connection_id);
     if ( (connection_id != 0) && (conn_data != NULL) ) {
 
-        pa_module* loopback_module;
-        if ( true == is_source_sink_builtin(conn_data->source_id, u->source_map)
-                && true == is_source_sink_builtin(conn_data->sink_id, u->sink_map) ) {
-            loopback_module = get_loopback_module(u, conn_data->source_id, conn_data->sink_id);
-            if ( loopback_module ) {
+        pa_module* loopback_module = get_loopback_module(u, conn_data);
+        if ( loopback_module ) {
+            /* the loopback may still be in use by another connection between the same source and sink */
+            am_connect_t* sharing = router_connection_get_by_source_sink(u->connection_map, conn_data->source_id,
+                    conn_data->sink_id);
+            if ( (sharing == NULL) || (sharing->loopback_module_index != loopback_module->index) ) {
 #if PA_CHECK_VERSION(7,99,1)
             	pa_module_unload(loopback_module, true);
 #else
@@ -1774,7 +2146,6 @@ static uint16_t cb_routing_async_disconnect(struct userdata *u, uint16_t handle,
 #endif
             }
         }
-        pa_hashmap_remove(u->connection_map, (void*) (intptr_t) connection_id);
         pa_xfree(conn_data);
     }
 
@@ -1787,147 +2158,133 @@ static uint16_t cb_routing_async_disconnect(struct userdata *u, uint16_t handle,
 }
 
 /**
- * @brief The callback function from the dbus interface, when async set sink volume is received.
+ * @brief This function applies the volume requested by the audiomanager to a sink, the volume is remembered in
+ * the sink map as well. An id the module does not know gets no map entry, so that ids which were never
+ * registered can not fill up the map.
  * @param: u: The pointer to the user data.
- *         handle: The indentifier for this request.
  *         sink_id: sink id.
  *         volume: The volume to be set for sink.
- *         ramp_type: The type of ramp from source to destination volume
- *         ramp_time: The time for the volume change from source to destination volume.
- * @return uint16_t: The return for this request.
+ * @return uint16_t: E_OK, or E_NON_EXISTENT if the id is not known.
  */
-static uint16_t cb_routing_async_set_sink_volume(struct userdata *u, uint16_t handle, uint16_t sink_id, int16_t volume,
-        int16_t ramp_type, uint16_t ramp_time) {
-
-    ROUTER_FUNCTION_ENTRY;
+static uint16_t apply_sink_volume(struct userdata *u, uint16_t sink_id, int16_t volume) {
     pa_cvolume channelVolume;
 
     pa_assert(u);
 
     float volume_norm = (-65535.0 / 3000) * (-3000 - (int16_t) volume);
-    pa_log_debug("cb_routing_async_set_sink_volume RequestedVol = %d NormalizedVol = %f", volume, volume_norm);
+    pa_log_debug("apply_sink_volume RequestedVol = %d NormalizedVol = %f", volume, volume_norm);
 
-    int index = get_map_index_from_id(sink_id, u->sink_map);
+    int index = get_map_index_from_id(sink_id, &u->sink_map);
     if ( index != -1 ) {
-        if ( u->sink_map[index].builtin == false ) {
-            pa_source_output *source_output = (pa_source_output*) u->sink_map[index].data;
+        if ( u->sink_map.builtin[index] == false ) {
+            pa_source_output *source_output = (pa_source_output*) u->sink_map.data[index];
             if ( source_output != NULL ) {
                 set_pa_volume(&channelVolume, source_output->volume.channels, (uint32_t) volume_norm);
                 pa_source_output_set_volume(source_output, &channelVolume, false, false);
             }
         } else {
-            pa_sink* sink = (pa_sink*) u->sink_map[index].data;
+            /* bound by hook_callback_sink_put, the volume is applied there if the sink is not yet put */
+            pa_sink* sink = (pa_sink*) u->sink_map.data[index];
             if ( sink != NULL ) {
                 set_pa_volume(&channelVolume, sink->soft_volume.channels, (uint32_t) volume_norm);
                 pa_sink_set_volume(sink, &channelVolume, false, false);
             }
-            else {
-                /*
-                *Try to find the sink from the user structure
-                */
-                 uint32_t index;
-                 PA_IDXSET_FOREACH(sink, u->core->sinks, index) {
-                     char sink_am_name[AM_MAX_NAME_LENGTH];
-                     get_am_name_from_device_description(sink->proplist,sink_am_name);
-                     if(sink_am_name[0]!='\0')
-                     {
-                         int sink_map_index = get_map_index_from_name(sink_am_name,u->sink_map);
-                         if(sink_map_index != -1)
-                         {
-                             u->sink_map[sink_map_index].data = sink;
-                             set_pa_volume(&channelVolume, sink->soft_volume.channels, (uint32_t) volume_norm);
-                             pa_sink_set_volume(sink, &channelVolume, false, false);
-                             break;
-                         }
-                     }
-                 }
-            }
         }
     } else {
-        index = get_free_map_index(u->sink_map);
-    }
-    if ( index != -1 ) {
-        u->sink_map[index].id = sink_id;
-        u->sink_map[index].volume = volume_norm;
-        u->sink_map[index].volume_valid = true;
+        pa_log_warn("apply_sink_volume: unknown sink id %u", sink_id);
+        return E_NON_EXISTENT;
     }
-
-    router_dbus_ack_set_sink_volume(u, handle, volume, E_OK);
-#if ROUTER_MODULE_EXTRA_LOGS
-    print_maps();
-#endif
-    ROUTER_FUNCTION_EXIT;
+    u->sink_map.entry[index].volume = volume_norm;
+    u->sink_map.entry[index].volume_valid = true;
     return E_OK;
 }
 
 /**
- * @brief The callback function from the dbus interface, when async set source volume is received.
+ * @brief This function applies the volume requested by the audiomanager to a source, the volume is remembered in
+ * the source map as well. An id the module does not know gets no map entry, so that ids which were never
+ * registered can not fill up the map.
  * @param: u: The pointer to the user data.
- *         handle: The indentifier for this request.
  *         source_id: source id.
- *         volume: The volume to be set for sink.
- *         ramp_type: The type of ramp from source to destination volume
- *         ramp_time: The time for the volume change from source to destination volume.
- * @return uint16_t: The return for this request.
+ *         volume: The volume to be set for source.
+ * @return uint16_t: E_OK, or E_NON_EXISTENT if the id is not known.
  */
-
-static uint16_t cb_routing_async_set_source_volume(struct userdata *u, uint16_t handle, uint16_t source_id,
-        int16_t volume, int16_t ramp_type, uint16_t ramp_time) {
-    ROUTER_FUNCTION_ENTRY;
+static uint16_t apply_source_volume(struct userdata *u, uint16_t source_id, int16_t volume) {
     pa_cvolume channelVolume;
 
     pa_assert(u);
 
     float volume_norm = (-65535.0 / 3000) * (-3000 - volume);
-    pa_log_debug("cb_routing_async_set_source_volume RequestedVol = %d NormalizedVol = %f", volume, volume_norm);
+    pa_log_debug("apply_source_volume RequestedVol = %d NormalizedVol = %f", volume, volume_norm);
 
     // get the sink_input from the id
-    int index = get_map_index_from_id(source_id, u->source_map);
+    int index = get_map_index_from_id(source_id, &u->source_map);
     if ( index != -1 ) {
-        if ( u->source_map[index].builtin == false ) {
-            pa_sink_input *sink_input = (pa_sink_input*) u->source_map[index].data;
+        if ( u->source_map.builtin[index] == false ) {
+            pa_sink_input *sink_input = (pa_sink_input*) u->source_map.data[index];
             if ( sink_input != NULL ) {
                 set_pa_volume(&channelVolume, sink_input->volume.channels, (uint32_t) volume_norm);
                 pa_sink_input_set_volume(sink_input, &channelVolume, false, false);
             }
         } else {
-            pa_source* source = (pa_source*) u->source_map[index].data;
+            /* bound by hook_callback_source_put, the volume is applied there if the source is not yet put */
+            pa_source* source = (pa_source*) u->source_map.data[index];
             if ( source != NULL ) {
                 set_pa_volume(&channelVolume, source->real_volume.channels, (uint32_t) volume_norm);
                 pa_source_set_volume(source, &channelVolume, false, false);
             }
-            else {
-                uint32_t index;
-                ROUTER_FUNCTION_ENTRY;
-                PA_IDXSET_FOREACH(source, u->core->sources, index)
-                {
-                    char source_am_name[AM_MAX_NAME_LENGTH];
-                    get_am_name_from_device_description(source->proplist,source_am_name);
-                    if(source_am_name[0]!='\0')
-                    {
-                        int source_map_index = get_map_index_from_name(source_am_name,u->sink_map);
-                        if(source_map_index != -1)
-                        {
-                            u->sink_map[source_map_index].data = source;
-                            set_pa_volume(&channelVolume, source->real_volume.channels, (uint32_t) volume_norm);
-                            pa_source_set_volume(source, &channelVolume, false, false);
-                            break;
-                        }
-                    }
-                }
-
-            }
         }
     } else {
-        index = get_free_map_index(u->source_map);
-    }
-    if ( index != -1 ) {
-        u->source_map[index].id = source_id;
-        u->source_map[index].volume = volume_norm;
-        u->source_map[index].volume_valid = true;
+        pa_log_warn("apply_source_volume: unknown source id %u", source_id);
+        return E_NON_EXISTENT;
     }
+    u->source_map.entry[index].volume = volume_norm;
+    u->source_map.entry[index].volume_valid = true;
+    return E_OK;
+}
+
+/**
+ * @brief The callback function from the dbus interface, when async set sink volume is received.
+ * @param: u: The pointer to the user data.
+ *         handle: The indentifier for this request.
+ *         sink_id: sink id.
+ *         volume: The volume to be set for sink.
+ *         ramp_type: The type of ramp from source to destination volume
+ *         ramp_time: The time for the volume change from source to destination volume.
+ * @return uint16_t: The return for this request.
+ */
+static uint16_t cb_routing_async_set_sink_volume(struct userdata *u, uint16_t handle, uint16_t sink_id, int16_t volume,
+        int16_t ramp_type, uint16_t ramp_time) {
+    uint16_t status;
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
+
+    status = apply_sink_volume(u, sink_id, volume);
+    router_dbus_ack_set_sink_volume(u, handle, volume, status);
+#if ROUTER_MODULE_EXTRA_LOGS
+    print_maps();
+#endif
+    ROUTER_FUNCTION_EXIT;
+    return E_OK;
+}
+
+/**
+ * @brief The callback function from the dbus interface, when async set source volume is received.
+ * @param: u: The pointer to the user data.
+ *         handle: The indentifier for this request.
+ *         source_id: source id.
+ *         volume: The volume to be set for sink.
+ *         ramp_type: The type of ramp from source to destination volume
+ *         ramp_time: The time for the volume change from source to destination volume.
+ * @return uint16_t: The return for this request.
+ */
+static uint16_t cb_routing_async_set_source_volume(struct userdata *u, uint16_t handle, uint16_t source_id,
+        int16_t volume, int16_t ramp_type, uint16_t ramp_time) {
+    uint16_t status;
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
 
-    router_dbus_ack_set_source_volume(u, handle, volume, E_OK);
+    status = apply_source_volume(u, source_id, volume);
+    router_dbus_ack_set_source_volume(u, handle, volume, status);
 #if ROUTER_MODULE_EXTRA_LOGS
     print_maps();
 #endif
@@ -1935,6 +2292,50 @@ static uint16_t cb_routing_async_set_source_volume(struct userdata *u, uint16_t
     return E_OK;
 }
 
+/**
+ * @brief The callback function from the dbus interface, when async set volumes is received. All the volumes are
+ * applied in this main loop pass and acked together.
+ * @param: u: The pointer to the user data.
+ *         handle: The indentifier for this request.
+ *         volumes: The volumes to be set.
+ *         count: The number of volumes.
+ * @return uint16_t: The return for this request, a failed element is only reported in the ack.
+ */
+static uint16_t cb_routing_async_set_volumes(struct userdata *u, uint16_t handle, const am_volume_t *volumes,
+        uint32_t count) {
+    uint16_t status = E_OK;
+    uint16_t element_status;
+    uint32_t i;
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
+    pa_assert(volumes || (count == 0));
+
+    /* every element which can be applied is, the ack carries the error of the last one which could not */
+    for ( i = 0; i < count; i++ ) {
+        switch ( volumes[i].type ) {
+            case VT_SINK:
+                element_status = apply_sink_volume(u, volumes[i].id, volumes[i].volume);
+                break;
+            case VT_SOURCE:
+                element_status = apply_source_volume(u, volumes[i].id, volumes[i].volume);
+                break;
+            default:
+                pa_log_warn("unknown volume type %d for id %u", volumes[i].type, volumes[i].id);
+                element_status = E_NOT_POSSIBLE;
+                break;
+        }
+        if ( element_status != E_OK ) {
+            status = element_status;
+        }
+    }
+    router_dbus_ack_set_volumes(u, handle, volumes, count, status);
+#if MODULE_ROUTER_EXTRA_LOGS
+    print_maps(u);
+#endif
+    ROUTER_FUNCTION_EXIT;
+    return E_OK;
+}
+
 /**
  * @brief The callback function from the dbus interface, when async set source state is received.
  * @param: u: The pointer to the user data.
@@ -1949,13 +2350,14 @@ static uint16_t cb_routing_async_set_source_state(struct userdata *u, uint16_t h
     ROUTER_FUNCTION_ENTRY;
     bool found = false;
     int source_index;
+    uint16_t status = E_OK;
     pa_assert(u);
 
     pa_log_debug("cb_routing_async_set_source_state handle = %d, source_id =%d, state = %d", handle, source_id, state);
-    source_index = get_map_index_from_id(source_id, u->source_map);
+    source_index = get_map_index_from_id(source_id, &u->source_map);
     if ( source_index != -1 ) {
-        if ( u->source_map[source_index].builtin == false ) {
-            pa_sink_input* sink_input = (pa_sink_input*) u->source_map[source_index].data;
+        if ( u->source_map.builtin[source_index] == false ) {
+            pa_sink_input* sink_input = (pa_sink_input*) u->source_map.data[source_index];
             if ( sink_input != NULL ) {
                 bool corked = (pa_sink_input_get_state(sink_input) == PA_SINK_INPUT_CORKED);
                 pa_log_debug("sink input corked = %d", corked);
@@ -1978,8 +2380,8 @@ static uint16_t cb_routing_async_set_source_state(struct userdata *u, uint16_t h
                 }
             }
         } else {
-            pa_source* source = (pa_source*) u->source_map[source_index].data;
-            if ( (source != NULL) && (u->source_map[source_index].builtin == true) ) {
+            pa_source* source = (pa_source*) u->source_map.data[source_index];
+            if ( (source != NULL) && (u->source_map.builtin[source_index] == true) ) {
                 if ( state == SS_ON ) {
                     pa_source_suspend(source, false, PA_SUSPEND_INTERNAL);
                 } else {
@@ -1987,15 +2389,13 @@ static uint16_t cb_routing_async_set_source_state(struct userdata *u, uint16_t h
                 }
             }
         }
+        u->source_map.source_state[source_index] = state;
     } else {
-        source_index = get_free_map_index(u->source_map);
-    }
-    if ( source_index != -1 ) {
-        u->source_map[source_index].id = source_id;
-        u->source_map[source_index].source_state = state;
+        pa_log_warn("cb_routing_async_set_source_state: unknown source id %u", source_id);
+        status = E_NON_EXISTENT;
     }
 
-    router_dbus_ack_set_source_state(u, handle, E_OK);
+    router_dbus_ack_set_source_state(u, handle, status);
 #if MODULE_ROUTER_EXTRA_LOGS
     print_maps(u);
 #endif
@@ -2016,11 +2416,28 @@ int pa__init(pa_module *m) {
     unsigned int i = 0;
     router_init_data_t init_data;
     am_domain_register_t *domain;
+    pa_modargs *ma;
+    uint32_t reply_timeout = AM_REPLY_TIMEOUT_DEFAULT;
+    char *am_address;
     ROUTER_FUNCTION_ENTRY;
     pa_assert(m);
+
+    if ( (ma = pa_modargs_new(m->argument, valid_modargs)) == NULL ) {
+        pa_log_error("failed to parse module arguments");
+        return -1;
+    }
+    if ( (pa_modargs_get_value_u32(ma, "am_reply_timeout", &reply_timeout) < 0) || (reply_timeout == 0) ) {
+        pa_log_error("am_reply_timeout expects a positive number of ms");
+        pa_modargs_free(ma);
+        return -1;
+    }
+    am_address = pa_xstrdup(pa_modargs_get_value(ma, "am_address", NULL));
+    pa_modargs_free(ma);
+
     m->userdata = u = pa_xnew0(struct userdata, 1);
     pa_assert(u);
     u->core = m->core;
+    u->module = m;
     u->h = pa_xnew0(struct router_hooks, 1);
     pa_assert(u->h);
 
@@ -2042,6 +2459,16 @@ int pa__init(pa_module *m) {
             (pa_hook_cb_t) hook_callback_source_new, u);
     u->h->hook_slot_source_output_new = pa_hook_connect(&m->core->hooks[PA_CORE_HOOK_SOURCE_OUTPUT_NEW],
             PA_HOOK_LATE + 30, (pa_hook_cb_t) hook_callback_source_output_new, u);
+    u->h->hook_slot_sink_put = pa_hook_connect(&m->core->hooks[PA_CORE_HOOK_SINK_PUT], PA_HOOK_LATE + 30,
+            (pa_hook_cb_t) hook_callback_sink_put, u);
+    u->h->hook_slot_sink_unlink = pa_hook_connect(&m->core->hooks[PA_CORE_HOOK_SINK_UNLINK], PA_HOOK_LATE + 30,
+            (pa_hook_cb_t) hook_callback_sink_unlink, u);
+    u->h->hook_slot_source_put = pa_hook_connect(&m->core->hooks[PA_CORE_HOOK_SOURCE_PUT], PA_HOOK_LATE + 30,
+            (pa_hook_cb_t) hook_callback_source_put, u);
+    u->h->hook_slot_source_unlink = pa_hook_connect(&m->core->hooks[PA_CORE_HOOK_SOURCE_UNLINK], PA_HOOK_LATE + 30,
+            (pa_hook_cb_t) hook_callback_source_unlink, u);
+    u->h->module_subscription = pa_subscription_new(m->core, PA_SUBSCRIPTION_MASK_MODULE,
+            subscription_callback_module, u);
 
     /*
      * initialize dbus interface
@@ -2059,7 +2486,8 @@ int pa__init(pa_module *m) {
     init_data.am_routing_dbus_name = pa_xstrdup(AM_ROUTING_DBUS_NAME);
     init_data.am_routing_dbus_interface_name = pa_xstrdup(AM_ROUTING_DBUS_INTERFACE_NAME);
     init_data.am_routing_dbus_path = pa_xstrdup(AM_ROUTING_DBUS_PATH);
-    init_data.am_watch_rule = pa_xstrdup(AM_COMMAND_SIGNAL_WATCH_RULE);
+    init_data.reply_timeout = reply_timeout;
+    init_data.am_address = am_address;
     init_data.cb_new_main_connection = cb_new_main_connection;
     init_data.cb_removed_main_connection = cb_removed_main_connection;
     init_data.cb_main_connection_state_changed = cb_main_connection_state_changed;
@@ -2075,10 +2503,17 @@ int pa__init(pa_module *m) {
     init_data.cb_routing_async_disconnect = cb_routing_async_disconnect;
     init_data.cb_routing_async_set_sink_volume = cb_routing_async_set_sink_volume;
     init_data.cb_routing_async_set_source_volume = cb_routing_async_set_source_volume;
+    init_data.cb_routing_async_set_volumes = cb_routing_async_set_volumes;
     init_data.cb_routing_async_set_source_state = cb_routing_async_set_source_state;
     init_data.cb_routing_peek_sink_reply = cb_routing_peek_sink_reply;
     init_data.cb_routing_peek_source_reply = cb_routing_peek_source_reply;
     init_data.cb_routing_get_domain_of_source_reply = cb_routing_get_domain_of_source;
+    init_data.cb_routing_register_batch_done = cb_routing_register_batch_done;
+    init_data.cb_new_sink = cb_new_sink;
+    init_data.cb_new_source = cb_new_source;
+    init_data.cb_removed_sink = cb_removed_sink;
+    init_data.cb_removed_source = cb_removed_source;
+    init_data.cb_am_owner_changed = cb_am_owner_changed;
     init_data.cb_routing_get_domain_of_sink_reply = cb_routing_get_domain_of_sink;
 
     u->dbusif = router_dbusif_init(u, &init_data);
@@ -2093,7 +2528,7 @@ int pa__init(pa_module *m) {
     MODULE_ROUTER_FREE(init_data.am_routing_dbus_name);
     MODULE_ROUTER_FREE(init_data.am_routing_dbus_interface_name);
     MODULE_ROUTER_FREE(init_data.am_routing_dbus_path);
-    MODULE_ROUTER_FREE(init_data.am_watch_rule);
+    MODULE_ROUTER_FREE(init_data.am_address);
 
     /*
      * register pulse domain
@@ -2107,18 +2542,26 @@ int pa__init(pa_module *m) {
     domain->complete = true;
     domain->state = DS_CONTROLLED;
 
-    memset(u->source_map, 0, sizeof(u->source_map));
-    memset(u->sink_map, 0, sizeof(u->sink_map));
+    u->strings = router_strings_new();
+    router_map_init(&u->source_map, u->strings);
+    router_map_init(&u->sink_map, u->strings);
     router_dbusif_routing_register_domain(u, domain);
     u->domain = domain;
     /*
      * create main connection hash map
      */
-    u->main_connection_map = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+    u->main_connection_map = router_connection_table_new(pa_xfree);
     /*
      * create connection hash map
      */
-    u->connection_map = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+    u->connection_map = router_connection_table_new(pa_xfree);
+    /*
+     * create the hash maps of the sources and sinks being admitted, keyed by name
+     */
+    u->source_admissions = pa_hashmap_new_full(pa_idxset_string_hash_func, pa_idxset_string_compare_func, NULL,
+            admission_free);
+    u->sink_admissions = pa_hashmap_new_full(pa_idxset_string_hash_func, pa_idxset_string_compare_func, NULL,
+            admission_free);
 
     ROUTER_FUNCTION_EXIT;
     return 0;
@@ -2143,10 +2586,52 @@ void pa__done(pa_module *m) {
                 if ( u->h->hook_slot_sink_input_unlink ) {
                     pa_hook_slot_free(u->h->hook_slot_sink_input_unlink);
                 }
+                if ( u->h->hook_slot_source_output_put ) {
+                    pa_hook_slot_free(u->h->hook_slot_source_output_put);
+                }
+                if ( u->h->hook_slot_source_output_unlink ) {
+                    pa_hook_slot_free(u->h->hook_slot_source_output_unlink);
+                }
+                if ( u->h->hook_slot_sink_new ) {
+                    pa_hook_slot_free(u->h->hook_slot_sink_new);
+                }
+                if ( u->h->hook_slot_sink_input_new ) {
+                    pa_hook_slot_free(u->h->hook_slot_sink_input_new);
+                }
+                if ( u->h->hook_slot_source_new ) {
+                    pa_hook_slot_free(u->h->hook_slot_source_new);
+                }
+                if ( u->h->hook_slot_source_output_new ) {
+                    pa_hook_slot_free(u->h->hook_slot_source_output_new);
+                }
+                if ( u->h->hook_slot_sink_put ) {
+                    pa_hook_slot_free(u->h->hook_slot_sink_put);
+                }
+                if ( u->h->hook_slot_sink_unlink ) {
+                    pa_hook_slot_free(u->h->hook_slot_sink_unlink);
+                }
+                if ( u->h->hook_slot_source_put ) {
+                    pa_hook_slot_free(u->h->hook_slot_source_put);
+                }
+                if ( u->h->hook_slot_source_unlink ) {
+                    pa_hook_slot_free(u->h->hook_slot_source_unlink);
+                }
+                if ( u->h->module_subscription ) {
+                    pa_subscription_free(u->h->module_subscription);
+                }
                 pa_xfree(u->h);
             }
-            pa_hashmap_free(u->main_connection_map);;
-            pa_hashmap_free(u->connection_map);
+            if ( u->source_admissions ) {
+                pa_hashmap_free(u->source_admissions);
+            }
+            if ( u->sink_admissions ) {
+                pa_hashmap_free(u->sink_admissions);
+            }
+            router_connection_table_free(u->main_connection_map);
+            router_connection_table_free(u->connection_map);
+            router_map_done(&u->source_map);
+            router_map_done(&u->sink_map);
+            router_strings_free(u->strings);
             MODULE_ROUTER_FREE(u->domain);
             pa_xfree(u);
         }
@@ -0,0 +1,256 @@
+/******************************************************************************
+ * @file: router-connection.c
+ *
+ * The file contains the implementation of the connection tables of the router
+ * module. A connection table stores the connections by connection id and
+ * keeps secondary indices by source id, by sink id and by source/sink pair.
+ * Several connections may share a key of a secondary index, the connections
+ * of one key are kept in a doubly linked list whose head is stored in the
+ * index.
+ *
+ * @component: PulseAudio router module
+ *
+ * @author: Toshiaki Isogai <tisogai@jp.adit-jv.com>
+ *          Kapildev Patel  <kpatel@jp.adit-jv.com>
+ *
+ * @copyright (c) 2016 Advanced Driver Information Technology.
+ * This code is developed by Advanced Driver Information Technology.
+ * Copyright of Advanced Driver Information Technology, Bosch, and DENSO.
+ * All rights reserved.
+ *
+ *****************************************************************************/
+
+#include <pulsecore/pulsecore-config.h>
+#include <stdint.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/idxset.h>
+#include <pulsecore/hashmap.h>
+#include "router-userdata.h"
+#include "router-connection.h"
+
+typedef enum {
+    BY_SOURCE = 0,
+    BY_SINK,
+    BY_SOURCE_SINK,
+    INDEX_MAX
+} router_connection_index_t;
+
+typedef struct router_connection_node_t {
+    uint16_t connection_id;
+    uint32_t key[INDEX_MAX];
+    struct router_connection_node_t *next[INDEX_MAX];
+    struct router_connection_node_t *prev[INDEX_MAX];
+    void *data;
+} router_connection_node;
+
+struct router_connection_table {
+    pa_hashmap *by_id;
+    pa_hashmap *index[INDEX_MAX];
+    pa_free_cb_t free_cb;
+};
+
+#define KEY_TO_PTR(key) ((void*) (uintptr_t) (key))
+#define SOURCE_SINK_KEY(source_id, sink_id) (((uint32_t) (source_id) << 16) | (uint32_t) (sink_id))
+
+/**
+ * @brief This function creates an empty connection table.
+ * @param free_cb: The function used to free the connection data when the table is freed, can be NULL.
+ * @return router_connection_table*: The pointer to the table.
+ */
+router_connection_table* router_connection_table_new(pa_free_cb_t free_cb) {
+    router_connection_table *table = pa_xnew0(router_connection_table, 1);
+    table->by_id = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+    for ( int i = 0 ; i < INDEX_MAX ; i++ ) {
+        table->index[i] = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+    }
+    table->free_cb = free_cb;
+    return table;
+}
+
+/**
+ * @brief This function frees the table together with the connections stored in it.
+ * @param table: The pointer to the table.
+ * @return void
+ */
+void router_connection_table_free(router_connection_table *table) {
+    router_connection_node *node;
+    if ( table == NULL ) {
+        return;
+    }
+    while ( (node = pa_hashmap_steal_first(table->by_id)) != NULL ) {
+        if ( table->free_cb ) {
+            table->free_cb(node->data);
+        }
+        pa_xfree(node);
+    }
+    pa_hashmap_free(table->by_id);
+    for ( int i = 0 ; i < INDEX_MAX ; i++ ) {
+        pa_hashmap_free(table->index[i]);
+    }
+    pa_xfree(table);
+}
+
+/**
+ * @brief This function links a connection into the list of its key in a secondary index.
+ * @param table: The pointer to the table.
+ *        i: The secondary index.
+ *        node: The connection.
+ * @return void
+ */
+static void index_link(router_connection_table *table, router_connection_index_t i, router_connection_node *node) {
+    router_connection_node *head = pa_hashmap_remove(table->index[i], KEY_TO_PTR(node->key[i]));
+    node->prev[i] = NULL;
+    node->next[i] = head;
+    if ( head ) {
+        head->prev[i] = node;
+    }
+    pa_hashmap_put(table->index[i], KEY_TO_PTR(node->key[i]), node);
+}
+
+/**
+ * @brief This function unlinks a connection from the list of its key in a secondary index.
+ * @param table: The pointer to the table.
+ *        i: The secondary index.
+ *        node: The connection.
+ * @return void
+ */
+static void index_unlink(router_connection_table *table, router_connection_index_t i, router_connection_node *node) {
+    if ( node->next[i] ) {
+        node->next[i]->prev[i] = node->prev[i];
+    }
+    if ( node->prev[i] ) {
+        node->prev[i]->next[i] = node->next[i];
+    } else {
+        pa_hashmap_remove(table->index[i], KEY_TO_PTR(node->key[i]));
+        if ( node->next[i] ) {
+            pa_hashmap_put(table->index[i], KEY_TO_PTR(node->key[i]), node->next[i]);
+        }
+    }
+    node->next[i] = node->prev[i] = NULL;
+}
+
+/**
+ * @brief This function adds a connection to the table.
+ * @param table: The pointer to the table.
+ *        connection_id: The id of the connection.
+ *        source_id: The source of the connection.
+ *        sink_id: The sink of the connection.
+ *        data: The connection data, owned by the table until it is removed.
+ * @return bool: false if a connection with the same id is already present.
+ */
+bool router_connection_put(router_connection_table *table, uint16_t connection_id, uint16_t source_id,
+        uint16_t sink_id, void *data) {
+    router_connection_node *node;
+    pa_assert(table);
+    pa_assert(data);
+
+    if ( pa_hashmap_get(table->by_id, KEY_TO_PTR(connection_id)) != NULL ) {
+        return false;
+    }
+    node = pa_xnew0(router_connection_node, 1);
+    node->connection_id = connection_id;
+    node->key[BY_SOURCE] = source_id;
+    node->key[BY_SINK] = sink_id;
+    node->key[BY_SOURCE_SINK] = SOURCE_SINK_KEY(source_id, sink_id);
+    node->data = data;
+    pa_hashmap_put(table->by_id, KEY_TO_PTR(connection_id), node);
+    for ( int i = 0 ; i < INDEX_MAX ; i++ ) {
+        index_link(table, (router_connection_index_t) i, node);
+    }
+    return true;
+}
+
+/**
+ * @brief This function returns the connection with the given id.
+ * @param table: The pointer to the table.
+ *        connection_id: The id of the connection.
+ * @return void*: The connection data, NULL if not found.
+ */
+void* router_connection_get(const router_connection_table *table, uint16_t connection_id) {
+    router_connection_node *node;
+    pa_assert(table);
+    node = pa_hashmap_get(table->by_id, KEY_TO_PTR(connection_id));
+    return node ? node->data : NULL;
+}
+
+/**
+ * @brief This function removes the connection with the given id from the table.
+ * @param table: The pointer to the table.
+ *        connection_id: The id of the connection.
+ * @return void*: The connection data which now belongs to the caller, NULL if not found.
+ */
+void* router_connection_remove(router_connection_table *table, uint16_t connection_id) {
+    router_connection_node *node;
+    void *data;
+    pa_assert(table);
+    node = pa_hashmap_remove(table->by_id, KEY_TO_PTR(connection_id));
+    if ( node == NULL ) {
+        return NULL;
+    }
+    for ( int i = 0 ; i < INDEX_MAX ; i++ ) {
+        index_unlink(table, (router_connection_index_t) i, node);
+    }
+    data = node->data;
+    pa_xfree(node);
+    return data;
+}
+
+/**
+ * @brief This function iterates over all the connections of the table.
+ * @param table: The pointer to the table.
+ *        state: The iteration state, must point to NULL for the first call.
+ * @return void*: The next connection data, NULL at the end.
+ */
+void* router_connection_iterate(const router_connection_table *table, void **state) {
+    router_connection_node *node;
+    pa_assert(table);
+    node = pa_hashmap_iterate(table->by_id, state, NULL);
+    return node ? node->data : NULL;
+}
+
+/**
+ * @brief This function returns the head of the list of a key in a secondary index.
+ * @param table: The pointer to the table.
+ *        i: The secondary index.
+ *        key: The key.
+ * @return void*: The connection data, NULL if not found.
+ */
+static void* index_get(const router_connection_table *table, router_connection_index_t i, uint32_t key) {
+    router_connection_node *node = pa_hashmap_get(table->index[i], KEY_TO_PTR(key));
+    return node ? node->data : NULL;
+}
+
+/**
+ * @brief This function returns a connection of the given source.
+ * @param table: The pointer to the table.
+ *        source_id: The source id.
+ * @return void*: The connection data, NULL if not found.
+ */
+void* router_connection_get_by_source(const router_connection_table *table, uint16_t source_id) {
+    pa_assert(table);
+    return index_get(table, BY_SOURCE, source_id);
+}
+
+/**
+ * @brief This function returns a connection of the given sink.
+ * @param table: The pointer to the table.
+ *        sink_id: The sink id.
+ * @return void*: The connection data, NULL if not found.
+ */
+void* router_connection_get_by_sink(const router_connection_table *table, uint16_t sink_id) {
+    pa_assert(table);
+    return index_get(table, BY_SINK, sink_id);
+}
+
+/**
+ * @brief This function returns a connection between the given source and sink.
+ * @param table: The pointer to the table.
+ *        source_id: The source id.
+ *        sink_id: The sink id.
+ * @return void*: The connection data, NULL if not found.
+ */
+void* router_connection_get_by_source_sink(const router_connection_table *table, uint16_t source_id,
+        uint16_t sink_id) {
+    pa_assert(table);
+    return index_get(table, BY_SOURCE_SINK, SOURCE_SINK_KEY(source_id, sink_id));
+}
@@ -0,0 +1,41 @@
+/******************************************************************************
+ * @file: router-connection.h
+ *
+ * The file contains the declarations of the connection tables of the router
+ * module. A connection table stores the connections by connection id and
+ * keeps secondary indices by source id, by sink id and by source/sink pair.
+ *
+ * @component: PulseAudio router module
+ *
+ * @author: Toshiaki Isogai <tisogai@jp.adit-jv.com>
+ *          Kapildev Patel  <kpatel@jp.adit-jv.com>
+ *
+ * @copyright (c) 2016 Advanced Driver Information Technology.
+ * This code is developed by Advanced Driver Information Technology.
+ * Copyright of Advanced Driver Information Technology, Bosch, and DENSO.
+ * All rights reserved.
+ *
+ *****************************************************************************/
+
+#ifndef __ROUTER_CONNECTION_H__
+#define __ROUTER_CONNECTION_H__
+
+router_connection_table* router_connection_table_new(pa_free_cb_t free_cb);
+void router_connection_table_free(router_connection_table *table);
+
+bool router_connection_put(router_connection_table *table, uint16_t connection_id, uint16_t source_id,
+        uint16_t sink_id, void *data);
+void* router_connection_get(const router_connection_table *table, uint16_t connection_id);
+void* router_connection_remove(router_connection_table *table, uint16_t connection_id);
+void* router_connection_iterate(const router_connection_table *table, void **state);
+
+void* router_connection_get_by_source(const router_connection_table *table, uint16_t source_id);
+void* router_connection_get_by_sink(const router_connection_table *table, uint16_t sink_id);
+void* router_connection_get_by_source_sink(const router_connection_table *table, uint16_t source_id,
+        uint16_t sink_id);
+
+#define ROUTER_CONNECTION_FOREACH(e, table, state) \
+    for ( (state) = NULL, (e) = router_connection_iterate((table), &(state)) ; (e) ; \
+            (e) = router_connection_iterate((table), &(state)) )
+
+#endif /* __ROUTER_CONNECTION_H__ */
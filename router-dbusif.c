@@ -18,28 +18,78 @@
  *****************************************************************************/
 
 #include <pulsecore/pulsecore-config.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <pulsecore/core-util.h>
 #include <pulsecore/dbus-shared.h>
 #include <pulsecore/protocol-dbus.h>
 #include <pulsecore/dbus-util.h>
 #include <pulsecore/llist.h>
+#include <pulsecore/queue.h>
+#include <pulse/rtclock.h>
 #include "router-userdata.h"
 #include "router-dbusif.h"
+#include "router-ring.h"
 #define GENIVI_DBUS_PLUGIN  1
 
 typedef void (*pending_cb_t)(struct userdata *, DBusMessage *, void *);
 
+/* a request which joined an identical call already in flight, it gets the reply of that call */
+typedef struct pending_waiter {
+    PA_LLIST_FIELDS(struct pending_waiter);
+    void *data;
+} pending_waiter_t;
+
 typedef struct pending {
     PA_LLIST_FIELDS(struct pending);
     struct userdata *u;
     DBusPendingCall *call;
     pending_cb_t cb;
     void *data;
+    dbus_uint32_t serial;
+    char *key;
+    PA_LLIST_HEAD(pending_waiter_t, waiters);
+    /* position of the call on the timer wheel */
+    unsigned slot;
+    unsigned rounds;
 } pending_dbus_calls_t;
 
+/* an ack waiting in the ack queue */
+typedef struct queued_ack {
+    DBusMessage *msg;
+} queued_ack_t;
+
+/* outgoing queue depth in bytes above which the acks are held back and below which they flow again */
+#define FLOW_HIGH_WATERMARK (64 * 1024)
+#define FLOW_LOW_WATERMARK (16 * 1024)
+/* outgoing queue depth in bytes above which new requests are refused */
+#define FLOW_HARD_LIMIT (4 * FLOW_HIGH_WATERMARK)
+/* number of acks held back above which new async requests are refused */
+#define ACK_QUEUE_LIMIT 256
+#define FLOW_RETRY_USEC (20 * PA_USEC_PER_MSEC)
+#define STATS_INTERVAL_USEC PA_USEC_PER_SEC
+
+#define PENDING_CHUNK_SIZE 32
+#define WHEEL_SLOTS 64
+#define WHEEL_TICK_USEC (100 * PA_USEC_PER_MSEC)
+
+/* pending calls are carved out of chunks which live until the interface is freed */
+typedef struct pending_chunk {
+    struct pending_chunk *next;
+    pending_dbus_calls_t calls[PENDING_CHUNK_SIZE];
+} pending_chunk_t;
+
 struct router_dbusif {
     pa_dbus_connection *conn;
+    /* optional peer to peer connection to the audiomanager, the routing traffic prefers it over the system bus */
+    pa_dbus_wrap_connection *peer;
+    pa_defer_event *peer_close_event;
+    char *am_address;
+    /* optional shared memory ring for the volume commands, opened on request of the audiomanager */
+    router_ring *ring;
+    pa_io_event *ring_event;
+    bool ring_dispatching;
+    uint32_t ring_acks;
     char *pulse_router_dbus_return_interface_name;
     char *pulse_router_dbus_name;
     char *pulse_router_dbus_interface_name;
@@ -50,7 +100,11 @@ struct router_dbusif {
     char *am_routing_dbus_name;
     char *am_routing_dbus_interface_name;
     char *am_routing_dbus_path;
-    char* am_watch_rule;
+    /* one match rule per command interface signal we dispatch, NULL terminated */
+    char** am_watch_rules;
+    char* am_owner_rule;
+    /* unique name of the current owner of the audiomanager routing name, NULL while it is not on the bus */
+    char *am_owner;
     cb_new_main_connection_t cb_new_main_connection;
     cb_removed_main_connection_t cb_removed_main_connection;
     cb_main_connection_state_changed_t cb_main_connection_state_changed;
@@ -69,14 +123,65 @@ struct router_dbusif {
     cb_routing_async_set_volume_t cb_routing_async_set_sink_volume;
     cb_routing_async_set_volume_t cb_routing_async_set_source_volume;
     cb_routing_async_set_source_state_t cb_routing_async_set_source_state;
+    cb_routing_async_set_volumes_t cb_routing_async_set_volumes;
     cb_routing_get_domain_of_source_reply_t cb_routing_get_domain_of_source_reply;
     cb_routing_get_domain_of_sink_reply_t cb_routing_get_domain_of_sink_reply;
-    PA_LLIST_HEAD(pending_dbus_calls_t, pending_call_list);
+    cb_routing_register_batch_done_t cb_routing_register_batch_done;
+    cb_element_changed_t cb_new_sink;
+    cb_element_changed_t cb_new_source;
+    cb_element_changed_t cb_removed_sink;
+    cb_element_changed_t cb_removed_source;
+    cb_am_owner_changed_t cb_am_owner_changed;
+    /* pending calls keyed by their own entry, serials repeat across the system bus and the peer connection */
+    pa_hashmap *calls;
+    pending_chunk_t *chunks;
+    PA_LLIST_HEAD(pending_dbus_calls_t, free_calls);
+    /* timer wheel expiring the calls the audiomanager did not reply to in time */
+    PA_LLIST_HEAD(pending_dbus_calls_t, wheel[WHEEL_SLOTS]);
+    unsigned wheel_pos;
+    pa_time_event *wheel_event;
+    bool wheel_running;
+    /* reply deadlines in ms keyed by method name, the other methods use reply_timeout */
+    pa_hashmap *deadlines;
+    uint32_t reply_timeout;
+    uint32_t expired;
+    /* single-flight calls in flight, keyed by method and request key */
+    pa_hashmap *inflight;
+    /* method call headers built at init, keyed by member of the routing and the command interface */
+    pa_hashmap *routing_templates;
+    pa_hashmap *command_templates;
+    /* member name lookups of the method and signal dispatch tables */
+    pa_hashmap *method_dispatch;
+    pa_hashmap *signal_dispatch;
+    /* pending calls of the registration batch still waiting for a reply */
+    pa_hashmap *batch;
+    bool batch_open;
+    uint32_t batch_size;
+    pa_usec_t batch_start;
+    /* acks waiting to be put on the bus, flushed once per main loop iteration */
+    pa_queue *acks;
+    pa_defer_event *ack_event;
+    /* flow control toward the audiomanager */
+    bool throttled;
+    pa_time_event *flow_event;
+    uint32_t signals_dispatched;
+    uint32_t signals_dropped;
+    uint32_t acks_queued;
+    uint32_t requests_refused;
+    pa_usec_t stats_time;
 };
 
 static void free_routerif(struct userdata * u);
+static bool peer_open(struct userdata *u);
+static void flush_acks(struct userdata *u, bool force);
+static void queued_ack_free(queued_ack_t *ack);
+static void ack_event_cb(pa_mainloop_api *m, pa_defer_event *e, void *userdata);
 
 static bool send_message_with_reply(struct userdata *, DBusMessage *, pending_cb_t, void *);
+static bool send_shared_message_with_reply(struct userdata *, DBusMessage *, pending_cb_t, void *, const char *);
+static DBusMessage* new_routing_message(router_dbusif *dbusif, const char *member);
+static DBusMessage* new_command_message(router_dbusif *dbusif, const char *member);
+static void batch_check_done(struct userdata *u);
 /*
  * callbacks for the synchronous messages
  */
@@ -92,6 +197,7 @@ static void router_dbusif_peek_source_reply_cb(struct userdata *, DBusMessage *,
 static void router_dbusif_peek_sink_reply_cb(struct userdata *, DBusMessage *, void *);
 static void router_dbusif_get_domain_of_source_reply_cb(struct userdata *, DBusMessage *, void *);
 static void router_dbusif_get_domain_of_sink_reply_cb(struct userdata *, DBusMessage *, void *);
+static void router_dbusif_get_name_owner_reply_cb(struct userdata *, DBusMessage *, void *);
 
 /* dbus message handlers */
 static DBusHandlerResult router_dbusif_routing_async_connect_handler(DBusConnection *conn, DBusMessage *msg, void *arg);
@@ -103,72 +209,422 @@ static DBusHandlerResult router_dbusif_routing_async_set_source_volume_handler(D
         void *arg);
 static DBusHandlerResult router_dbusif_routing_async_set_source_state_handler(DBusConnection *conn, DBusMessage *msg,
         void *arg);
+static DBusHandlerResult router_dbusif_routing_async_set_volumes_handler(DBusConnection *conn, DBusMessage *msg,
+        void *arg);
 static DBusHandlerResult router_dbusif_command_cb_new_connection_handler(DBusConnection *conn, DBusMessage *msg,
         void *arg);
 static DBusHandlerResult router_dbusif_command_cb_removed_connection_handler(DBusConnection *conn, DBusMessage *msg,
         void *arg);
 static DBusHandlerResult router_dbusif_command_cb_connection_state_changed_handler(DBusConnection *conn,
         DBusMessage *msg, void *arg);
+static DBusHandlerResult router_dbusif_command_cb_element_changed_handler(DBusConnection *conn, DBusMessage *msg,
+        void *arg);
+static DBusHandlerResult router_dbusif_name_owner_changed_handler(DBusConnection *conn, DBusMessage *msg,
+        void *arg);
+static DBusHandlerResult peer_filter(DBusConnection *conn, DBusMessage *msg, void *arg);
+static DBusHandlerResult router_dbusif_routing_open_ring_handler(DBusConnection *conn, DBusMessage *msg, void *arg);
+static DBusHandlerResult router_dbusif_routing_close_ring_handler(DBusConnection *conn, DBusMessage *msg, void *arg);
+static void ring_close(struct userdata *u);
 
 typedef DBusHandlerResult (*method_t)(DBusConnection *, DBusMessage *, void *);
 
+struct dispatch {
+    const char *name;
+    method_t method;
+    /* the request is answered by an ack, it is refused while the acks are backed up */
+    bool acked;
+};
+
+/* methods called by the audiomanager on the router object */
+static const struct dispatch method_dispatch_tbl[] = {
+        { "asyncConnect", router_dbusif_routing_async_connect_handler, true },
+        { "asyncDisconnect", router_dbusif_routing_async_disconnect_handler, true },
+        { "asyncSetSinkVolume", router_dbusif_routing_async_set_sink_volume_handler, true },
+        { "asyncSetSourceVolume", router_dbusif_routing_async_set_source_volume_handler, true },
+        { "asyncSetSourceState", router_dbusif_routing_async_set_source_state_handler, true },
+        { "asyncSetVolumes", router_dbusif_routing_async_set_volumes_handler, true },
+        { "openRing", router_dbusif_routing_open_ring_handler },
+        { "closeRing", router_dbusif_routing_close_ring_handler },
+        { NULL, NULL, false } };
+
+/* signals of the audiomanager command interface */
+static const struct dispatch signal_dispatch_tbl[] = {
+        { "NewMainConnection", router_dbusif_command_cb_new_connection_handler },
+        { "RemovedMainConnection", router_dbusif_command_cb_removed_connection_handler },
+        { "MainConnectionStateChanged", router_dbusif_command_cb_connection_state_changed_handler },
+        { "NewSink", router_dbusif_command_cb_element_changed_handler },
+        { "NewSource", router_dbusif_command_cb_element_changed_handler },
+        { "RemovedSink", router_dbusif_command_cb_element_changed_handler },
+        { "RemovedSource", router_dbusif_command_cb_element_changed_handler },
+        { NULL, NULL, false } };
+
+struct deadline {
+    const char *name;
+    uint32_t timeout;
+};
+
+/* the peek and domain lookups hold back a corked stream, they give up sooner than the other calls */
+static const struct deadline deadline_tbl[] = {
+        { "peekSink", 1000 },
+        { "peekSource", 1000 },
+        { "getDomainOfSink", 1000 },
+        { "getDomainOfSource", 1000 },
+        { NULL, 0 } };
+
+/* methods we call on the audiomanager routing interface, their headers are built once at init */
+static const char *const routing_members_tbl[] = {
+        "registerDomain",
+        "deregisterDomain",
+        "registerSink",
+        "deregisterSink",
+        "registerSource",
+        "deregisterSource",
+        "peekSink",
+        "peekSource",
+        "getDomainOfSink",
+        "getDomainOfSource",
+        "ackConnect",
+        "ackDisconnect",
+        "ackSetSinkVolume",
+        "ackSetSinkVolumeChange",
+        "ackSetSourceVolume",
+        "ackSetSourceVolumeChange",
+        "ackSetSourceState",
+        "ackSetVolumes",
+        NULL };
+
+/* methods we call on the audiomanager command interface */
+static const char *const command_members_tbl[] = {
+        "Connect",
+        "Disconnect",
+        NULL };
+
+/**
+ * @brief This function builds the member name lookup of the reply deadlines, none of them exceeds the default.
+ * @param reply_timeout: The default reply deadline in ms.
+ * @return pa_hashmap*: The hash map from member name to deadline in ms.
+ */
+static pa_hashmap* deadline_map_new(uint32_t reply_timeout) {
+    const struct deadline *d;
+    pa_hashmap *map = pa_hashmap_new(pa_idxset_string_hash_func, pa_idxset_string_compare_func);
+    for ( d = deadline_tbl; d->name ; d++ ) {
+        pa_hashmap_put(map, (void*) d->name, PA_UINT32_TO_PTR(PA_MIN(d->timeout, reply_timeout)));
+    }
+    return map;
+}
+
+/**
+ * @brief This function builds the member name lookup of a dispatch table.
+ * @param tbl: The dispatch table, terminated by a NULL name.
+ * @return pa_hashmap*: The hash map from member name to dispatch entry.
+ */
+static pa_hashmap* dispatch_map_new(const struct dispatch *tbl) {
+    const struct dispatch *d;
+    pa_hashmap *map = pa_hashmap_new(pa_idxset_string_hash_func, pa_idxset_string_compare_func);
+    for ( d = tbl; d->name ; d++ ) {
+        pa_hashmap_put(map, (void*) d->name, (void*) d);
+    }
+    return map;
+}
+
+/**
+ * @brief This function builds a match rule for every command interface signal of the dispatch table, so the bus only
+ * wakes us up for the signals we act on and only when the audiomanager sends them.
+ * Arguments can not be matched further, the bus only matches string arguments and ours are integers.
+ * @param routerif: The router interface structure.
+ * @return char**: The NULL terminated match rules.
+ */
+static char** watch_rules_new(router_dbusif *routerif) {
+    const struct dispatch *d;
+    char **rules;
+    unsigned n = 0;
+
+    for ( d = signal_dispatch_tbl; d->name; d++ ) {
+        n++;
+    }
+    rules = pa_xnew0(char*, n + 1);
+    for ( d = signal_dispatch_tbl, n = 0; d->name; d++, n++ ) {
+        rules[n] = pa_sprintf_malloc("type='signal',sender='%s',path='%s',interface='%s',member='%s'",
+                routerif->am_command_dbus_name, routerif->am_command_dbus_path,
+                routerif->am_command_dbus_interface_name, d->name);
+    }
+    return rules;
+}
+
+/**
+ * @brief This function frees the match rules built by watch_rules_new.
+ * @param rules: The NULL terminated match rules.
+ * @return void
+ */
+static void watch_rules_free(char **rules) {
+    char **rule;
+
+    if ( rules == NULL ) {
+        return;
+    }
+    for ( rule = rules; *rule; rule++ ) {
+        pa_xfree(*rule);
+    }
+    pa_xfree(rules);
+}
+
+/**
+ * @brief This function checks whether the audiomanager has stopped taking our traffic, either the acks held back by
+ * the flow control or the outgoing queue of the connection reached its limit.
+ * @param routerif: The router interface structure.
+ *        conn: The connection the request arrived on.
+ * @return bool true if no further async request should be accepted.
+ */
+static bool acks_backed_up(router_dbusif *routerif, DBusConnection *conn) {
+    return (routerif->acks_queued >= ACK_QUEUE_LIMIT) || (dbus_connection_get_outgoing_size(conn) >= FLOW_HARD_LIMIT);
+}
+
 /**
- * @brief The callback function when any request is received on dbus.
+ * @brief This function refuses an async request with an error reply, no ack is sent for it.
+ * @param routerif: The router interface structure.
+ *        conn: The dbus connection pointer.
+ *        msg: The dbus message.
+ * @return DBusHandlerResult
+ */
+static DBusHandlerResult refuse_request(router_dbusif *routerif, DBusConnection *conn, DBusMessage *msg) {
+    DBusMessage *reply;
+
+    pa_log_warn("%s: %u acks held back, refusing '%s'", __FILE__, routerif->acks_queued, dbus_message_get_member(msg));
+    routerif->requests_refused++;
+    if ( (reply = dbus_message_new_error(msg, DBUS_ERROR_LIMITS_EXCEEDED, "too many acks held back")) != NULL ) {
+        dbus_connection_send(conn, reply, NULL);
+        dbus_message_unref(reply);
+    }
+    return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+/**
+ * @brief The object path handler of the router object, only method calls on the router interface reach it.
  * @param conn: The dbus connection pointer.
  *        msg: The dbus message.
  *        args: The pointer which was registered while registering this function, The userdata.
  * @return DBusHandlerResult
  */
 static DBusHandlerResult router_dbusif_method_handler(DBusConnection *conn, DBusMessage *msg, void *arg) {
-    struct dispatch {
-        const char *name;
-        method_t method;
-    };
-
-    static struct dispatch dispatch_tbl[] = {
-            { "asyncConnect", router_dbusif_routing_async_connect_handler },
-            { "asyncDisconnect", router_dbusif_routing_async_disconnect_handler },
-            { "asyncSetSinkVolume", router_dbusif_routing_async_set_sink_volume_handler },
-            { "asyncSetSourceVolume", router_dbusif_routing_async_set_source_volume_handler },
-            { "asyncSetSourceState", router_dbusif_routing_async_set_source_state_handler },
-            { "NewMainConnection", router_dbusif_command_cb_new_connection_handler },
-            { "RemovedMainConnection", router_dbusif_command_cb_removed_connection_handler },
-            { "MainConnectionStateChanged", router_dbusif_command_cb_connection_state_changed_handler },
-            { NULL, NULL } };
+    struct userdata *u = (struct userdata *) arg;
+    const struct dispatch *d;
+    const char *interface;
+    const char *name;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(u);
+
+    if ( dbus_message_get_type(msg) != DBUS_MESSAGE_TYPE_METHOD_CALL ) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+    /* the audiomanager calls back on the interface advertised in registerDomain, which with the
+     * GENIVI plugin is its own routing interface, so both names are accepted */
+    interface = dbus_message_get_interface(msg);
+    if ( (interface != NULL) && strcmp(interface, u->dbusif->pulse_router_dbus_return_interface_name)
+            && strcmp(interface, u->dbusif->pulse_router_dbus_interface_name) ) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+    name = dbus_message_get_member(msg);
+    if ( (name == NULL) || ((d = pa_hashmap_get(u->dbusif->method_dispatch, name)) == NULL) ) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+    if ( d->acked && acks_backed_up(u->dbusif, conn) ) {
+        return refuse_request(u->dbusif, conn, msg);
+    }
+    pa_log_debug("Message with name=%s", name);
+    return d->method(conn, msg, u);
+}
 
+static const DBusObjectPathVTable router_object_vtable = { .message_function = router_dbusif_method_handler, };
+
+/**
+ * @brief The connection filter, it handles the signals of the audiomanager command interface and the bus
+ * NameOwnerChanged signal. Everything else is passed on untouched.
+ * @param conn: The dbus connection pointer.
+ *        msg: The dbus message.
+ *        args: The pointer which was registered while registering this function, The userdata.
+ * @return DBusHandlerResult
+ */
+static DBusHandlerResult router_dbusif_signal_filter(DBusConnection *conn, DBusMessage *msg, void *arg) {
     struct userdata *u = (struct userdata *) arg;
-    struct dispatch *d;
+    const struct dispatch *d;
+    const char *interface;
     const char *name;
-    dbus_int16_t errcod;
-    method_t method;
-    DBusMessage *reply;
-    dbus_bool_t success;
-    DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    ROUTER_FUNCTION_ENTRY;
 
     pa_assert(conn);
     pa_assert(msg);
     pa_assert(u);
 
-    if ( dbus_message_get_type(msg) == DBUS_MESSAGE_TYPE_METHOD_CALL
-            || dbus_message_get_type(msg) == DBUS_MESSAGE_TYPE_SIGNAL ) {
-        name = dbus_message_get_member(msg);
+    if ( dbus_message_get_type(msg) != DBUS_MESSAGE_TYPE_SIGNAL ) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+    interface = dbus_message_get_interface(msg);
+    name = dbus_message_get_member(msg);
+    if ( (interface == NULL) || (name == NULL) ) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+    if ( !strcmp(interface, u->dbusif->am_command_dbus_interface_name) ) {
+        /* with the per member match rules in place nothing should be dropped here */
+        if ( (dbus_message_has_path(msg, u->dbusif->am_command_dbus_path) == FALSE)
+                || ((d = pa_hashmap_get(u->dbusif->signal_dispatch, name)) == NULL) ) {
+            u->dbusif->signals_dropped++;
+            return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+        }
+        pa_log_debug("Signal with name=%s", name);
+        u->dbusif->signals_dispatched++;
+        return d->method(conn, msg, u);
+    }
+    if ( !strcmp(interface, DBUS_INTERFACE_DBUS) && !strcmp(name, "NameOwnerChanged") ) {
+        return router_dbusif_name_owner_changed_handler(conn, msg, u);
+    }
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+/**
+ * The decoded arguments of an asynchronous routing request. Each request only
+ * fills the members listed in its field table, the rest stay zero.
+ */
+typedef struct {
+    uint16_t handle;
+    uint16_t connection_id;
+    uint16_t source_id;
+    uint16_t sink_id;
+    int32_t connection_format;
+    int32_t volume;
+    int32_t ramp_type;
+    uint16_t ramp_time;
+    int32_t state;
+} async_request_t;
+
+struct request_field {
+    int type;
+    size_t offset;
+};
+
+struct request_decoder {
+    const char *signature;
+    const struct request_field *fields;
+    unsigned n_fields;
+};
+
+#define REQUEST_FIELD(type, member) { type, offsetof(async_request_t, member) }
+#define REQUEST_DECODER(signature, fields) { signature, fields, PA_ELEMENTSOF(fields) }
+
+static const struct request_field connect_fields[] = {
+    REQUEST_FIELD(DBUS_TYPE_UINT16, handle),
+    REQUEST_FIELD(DBUS_TYPE_UINT16, connection_id),
+    REQUEST_FIELD(DBUS_TYPE_UINT16, source_id),
+    REQUEST_FIELD(DBUS_TYPE_UINT16, sink_id),
+#ifdef GENIVI_DBUS_PLUGIN
+    REQUEST_FIELD(DBUS_TYPE_INT32, connection_format)
+#else
+    REQUEST_FIELD(DBUS_TYPE_INT16, connection_format)
+#endif
+};
+
+static const struct request_field disconnect_fields[] = {
+    REQUEST_FIELD(DBUS_TYPE_UINT16, handle),
+    REQUEST_FIELD(DBUS_TYPE_UINT16, connection_id)
+};
+
+static const struct request_field set_sink_volume_fields[] = {
+    REQUEST_FIELD(DBUS_TYPE_UINT16, handle),
+    REQUEST_FIELD(DBUS_TYPE_UINT16, sink_id),
+    REQUEST_FIELD(DBUS_TYPE_INT16, volume),
+    REQUEST_FIELD(DBUS_TYPE_INT16, ramp_type),
+    REQUEST_FIELD(DBUS_TYPE_UINT16, ramp_time)
+};
+
+static const struct request_field set_source_volume_fields[] = {
+    REQUEST_FIELD(DBUS_TYPE_UINT16, handle),
+    REQUEST_FIELD(DBUS_TYPE_UINT16, source_id),
+    REQUEST_FIELD(DBUS_TYPE_INT16, volume),
+    REQUEST_FIELD(DBUS_TYPE_INT16, ramp_type),
+    REQUEST_FIELD(DBUS_TYPE_UINT16, ramp_time)
+};
+
+static const struct request_field set_source_state_fields[] = {
+    REQUEST_FIELD(DBUS_TYPE_UINT16, handle),
+    REQUEST_FIELD(DBUS_TYPE_UINT16, source_id),
+#ifdef GENIVI_DBUS_PLUGIN
+    REQUEST_FIELD(DBUS_TYPE_INT32, state)
+#else
+    REQUEST_FIELD(DBUS_TYPE_INT16, state)
+#endif
+};
+
+/*
+ * The wire variant is fixed at build time, so the expected signature of
+ * every request is a constant string and a single compare rejects a bad
+ * message before any field is touched.
+ */
+#ifdef GENIVI_DBUS_PLUGIN
+static const struct request_decoder connect_decoder = REQUEST_DECODER("qqqqi", connect_fields);
+static const struct request_decoder set_source_state_decoder = REQUEST_DECODER("qqi", set_source_state_fields);
+#else
+static const struct request_decoder connect_decoder = REQUEST_DECODER("qqqqn", connect_fields);
+static const struct request_decoder set_source_state_decoder = REQUEST_DECODER("qqn", set_source_state_fields);
+#endif
+static const struct request_decoder disconnect_decoder = REQUEST_DECODER("qq", disconnect_fields);
+static const struct request_decoder set_sink_volume_decoder = REQUEST_DECODER("qqnnq", set_sink_volume_fields);
+static const struct request_decoder set_source_volume_decoder = REQUEST_DECODER("qqnnq", set_source_volume_fields);
+
+/**
+ * @brief Decodes the arguments of an asynchronous request.
+ * The signature is checked once against the decoder, then the arguments are
+ * copied into the request in a single iterator pass. Signed 16 bit values are
+ * widened to the 32 bit members of the request.
+ * @param msg: The dbus message.
+ *        decoder: The field table of the request.
+ *        req: The request to be filled.
+ * @return true on success, false if the signature does not match.
+ */
+static bool decode_request(DBusMessage *msg, const struct request_decoder *decoder, async_request_t *req) {
+    DBusMessageIter iter;
+    unsigned i;
 
-        pa_assert(name);
-        pa_log_debug("Message with name=%s", name);
-        for ( method = NULL, d = dispatch_tbl; d->name ; d++ ) {
-            if ( !strcmp(name, d->name) ) {
-                method = d->method;
+    pa_assert(msg);
+    pa_assert(decoder);
+    pa_assert(req);
+
+    memset(req, 0, sizeof(*req));
+    if ( dbus_message_has_signature(msg, decoder->signature) == FALSE ) {
+        pa_log_error("%s: unexpected signature '%s' for message '%s', expected '%s'", __FILE__,
+                dbus_message_get_signature(msg), dbus_message_get_member(msg), decoder->signature);
+        return false;
+    }
+    if ( dbus_message_iter_init(msg, &iter) == FALSE ) {
+        return false;
+    }
+    for ( i = 0; i < decoder->n_fields; i++ ) {
+        const struct request_field *f = &decoder->fields[i];
+        uint8_t *dest = (uint8_t *) req + f->offset;
+        switch ( f->type ) {
+            case DBUS_TYPE_UINT16: {
+                dbus_uint16_t value;
+                dbus_message_iter_get_basic(&iter, &value);
+                *(uint16_t *) dest = value;
                 break;
             }
+            case DBUS_TYPE_INT16: {
+                dbus_int16_t value;
+                dbus_message_iter_get_basic(&iter, &value);
+                *(int32_t *) dest = value;
+                break;
+            }
+            case DBUS_TYPE_INT32: {
+                dbus_int32_t value;
+                dbus_message_iter_get_basic(&iter, &value);
+                *(int32_t *) dest = value;
+                break;
+            }
+            default:
+                pa_assert_not_reached();
         }
-
-        if ( method ) {
-            result = method(conn, msg, u);
-        }
+        dbus_message_iter_next(&iter);
     }
-    ROUTER_FUNCTION_EXIT;
-    return result;
+    return true;
 }
 
 /**
@@ -179,9 +635,8 @@ static DBusHandlerResult router_dbusif_method_handler(DBusConnection *conn, DBus
  * @return DBusHandlerResult
  */
 static DBusHandlerResult router_dbusif_routing_async_connect_handler(DBusConnection *conn, DBusMessage *msg, void *arg) {
-    DBusError error;
     DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    am_connect_t cd;
+    async_request_t req;
     dbus_bool_t success = FALSE;
     dbus_int16_t status = E_NOT_POSSIBLE;
     DBusMessage *reply = NULL;
@@ -193,22 +648,7 @@ static DBusHandlerResult router_dbusif_routing_async_connect_handler(DBusConnect
     pa_assert(msg);
     pa_assert(name);
 
-    memset(&cd, 0, sizeof(cd));
-    dbus_error_init(&error);
-#ifdef GENIVI_DBUS_PLUGIN
-    success = dbus_message_get_args(msg, &error, DBUS_TYPE_UINT16, &cd.handle, DBUS_TYPE_UINT16, &cd.connection_id,
-            DBUS_TYPE_UINT16, &cd.source_id, DBUS_TYPE_UINT16, &cd.sink_id, DBUS_TYPE_INT32, &cd.connection_format,
-            DBUS_TYPE_INVALID);
-#else
-    success = dbus_message_get_args(msg, &error,
-            DBUS_TYPE_UINT16, &cd.handle,
-            DBUS_TYPE_UINT16, &cd.connection_id,
-            DBUS_TYPE_UINT16, &cd.source_id,
-            DBUS_TYPE_UINT16, &cd.sink_id,
-            DBUS_TYPE_INT16, &cd.connection_format,
-            DBUS_TYPE_INVALID);
-#endif
-    if ( success == TRUE ) {
+    if ( decode_request(msg, &connect_decoder, &req) ) {
         reply = dbus_message_new_method_return(msg);
         if ( reply ) {
             success = dbus_message_append_args(reply, DBUS_TYPE_UINT16, &status, DBUS_TYPE_INVALID);
@@ -222,16 +662,11 @@ static DBusHandlerResult router_dbusif_routing_async_connect_handler(DBusConnect
             dbus_message_unref(reply);
         }
         if ( u->dbusif->cb_routing_async_connect ) {
-            status = u->dbusif->cb_routing_async_connect(u, cd.handle, cd.connection_id, cd.source_id, cd.sink_id,
-                    cd.connection_format);
-        }
-    } else {
-        if ( dbus_error_is_set(&error) == TRUE ) {
-            pa_log_error("%s: error while parsing the message '%s', %s: %s", __FILE__, name, error.name, error.message);
+            status = u->dbusif->cb_routing_async_connect(u, req.handle, req.connection_id, req.source_id, req.sink_id,
+                    req.connection_format);
         }
     }
 
-    dbus_error_free(&error);
     ROUTER_FUNCTION_EXIT;
     return result;
 }
@@ -245,10 +680,8 @@ static DBusHandlerResult router_dbusif_routing_async_connect_handler(DBusConnect
  */
 static DBusHandlerResult router_dbusif_routing_async_disconnect_handler(DBusConnection *conn, DBusMessage *msg,
         void *arg) {
-    DBusError error;
     DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    uint16_t handle;
-    uint16_t connection;
+    async_request_t req;
     dbus_bool_t success = FALSE;
     dbus_int16_t status = E_NOT_POSSIBLE;
     DBusMessage *reply = NULL;
@@ -260,13 +693,9 @@ static DBusHandlerResult router_dbusif_routing_async_disconnect_handler(DBusConn
     pa_assert(msg);
     pa_assert(name);
 
-    dbus_error_init(&error);
-    success = dbus_message_get_args(msg, &error, DBUS_TYPE_UINT16, &handle, DBUS_TYPE_UINT16, &connection,
-            DBUS_TYPE_INVALID);
-
-    if ( success == TRUE ) {
+    if ( decode_request(msg, &disconnect_decoder, &req) ) {
         if ( u->dbusif->cb_routing_async_disconnect ) {
-            status = u->dbusif->cb_routing_async_disconnect(u, handle, connection);
+            status = u->dbusif->cb_routing_async_disconnect(u, req.handle, req.connection_id);
         }
         reply = dbus_message_new_method_return(msg);
         if ( reply ) {
@@ -280,13 +709,8 @@ static DBusHandlerResult router_dbusif_routing_async_disconnect_handler(DBusConn
             }
             dbus_message_unref(reply);
         }
-    } else {
-        if ( dbus_error_is_set(&error) == TRUE ) {
-            pa_log_error("%s: error while parsing the message '%s', %s: %s", __FILE__, name, error.name, error.message);
-        }
     }
 
-    dbus_error_free(&error);
     ROUTER_FUNCTION_EXIT;
     return result;
 }
@@ -300,18 +724,12 @@ static DBusHandlerResult router_dbusif_routing_async_disconnect_handler(DBusConn
  */
 static DBusHandlerResult router_dbusif_routing_async_set_sink_volume_handler(DBusConnection *conn, DBusMessage *msg,
         void *arg) {
-    DBusError error;
     DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    async_request_t req;
     dbus_bool_t success = FALSE;
     dbus_int16_t status = E_NOT_POSSIBLE;
     DBusMessage *reply = NULL;
 
-    uint16_t handle = 0;
-    uint16_t sink_id = 0;
-    int16_t volume = 0;
-    int16_t ramp_type = 0;
-    uint16_t ramp_time = 0;
-
     struct userdata *u = (struct userdata *) arg;
     const char *name = dbus_message_get_member(msg);
     ROUTER_FUNCTION_ENTRY;
@@ -319,11 +737,7 @@ static DBusHandlerResult router_dbusif_routing_async_set_sink_volume_handler(DBu
     pa_assert(msg);
     pa_assert(name);
 
-    dbus_error_init(&error);
-    success = dbus_message_get_args(msg, &error, DBUS_TYPE_UINT16, &handle, DBUS_TYPE_UINT16, &sink_id, DBUS_TYPE_INT16,
-            &volume, DBUS_TYPE_INT16, &ramp_type, DBUS_TYPE_UINT16, &ramp_time, DBUS_TYPE_INVALID);
-
-    if ( success == TRUE ) {
+    if ( decode_request(msg, &set_sink_volume_decoder, &req) ) {
         reply = dbus_message_new_method_return(msg);
         if ( reply ) {
             success = dbus_message_append_args(reply, DBUS_TYPE_UINT16, &status, DBUS_TYPE_INVALID);
@@ -337,16 +751,11 @@ static DBusHandlerResult router_dbusif_routing_async_set_sink_volume_handler(DBu
             dbus_message_unref(reply);
         }
         if ( u->dbusif->cb_routing_async_set_sink_volume ) {
-            status = u->dbusif->cb_routing_async_set_sink_volume(u, handle, sink_id, (int32_t) volume, ramp_type,
-                    ramp_time);
-        }
-    } else {
-        if ( dbus_error_is_set(&error) == TRUE ) {
-            pa_log_error("%s: error while parsing the message '%s', %s: %s", __FILE__, name, error.name, error.message);
+            status = u->dbusif->cb_routing_async_set_sink_volume(u, req.handle, req.sink_id, req.volume, req.ramp_type,
+                    req.ramp_time);
         }
     }
 
-    dbus_error_free(&error);
     ROUTER_FUNCTION_EXIT;
     return result;
 }
@@ -360,18 +769,12 @@ static DBusHandlerResult router_dbusif_routing_async_set_sink_volume_handler(DBu
  */
 static DBusHandlerResult router_dbusif_routing_async_set_source_volume_handler(DBusConnection *conn, DBusMessage *msg,
         void *arg) {
-    DBusError error;
     DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    async_request_t req;
     dbus_bool_t success = FALSE;
     dbus_int16_t status = E_NOT_POSSIBLE;
     DBusMessage *reply = NULL;
 
-    uint16_t handle = 0;
-    uint16_t source_id = 0;
-    int16_t volume = 0;
-    int32_t ramp_type = 0;
-    uint16_t ramp_time = 0;
-
     struct userdata *u = (struct userdata *) arg;
     const char *name = dbus_message_get_member(msg);
     ROUTER_FUNCTION_ENTRY;
@@ -379,11 +782,7 @@ static DBusHandlerResult router_dbusif_routing_async_set_source_volume_handler(D
     pa_assert(msg);
     pa_assert(name);
 
-    dbus_error_init(&error);
-    success = dbus_message_get_args(msg, &error, DBUS_TYPE_UINT16, &handle, DBUS_TYPE_UINT16, &source_id,
-            DBUS_TYPE_INT16, &volume, DBUS_TYPE_INT16, &ramp_type, DBUS_TYPE_UINT16, &ramp_time, DBUS_TYPE_INVALID);
-
-    if ( success == TRUE ) {
+    if ( decode_request(msg, &set_source_volume_decoder, &req) ) {
         reply = dbus_message_new_method_return(msg);
         if ( reply ) {
             success = dbus_message_append_args(reply, DBUS_TYPE_UINT16, &status, DBUS_TYPE_INVALID);
@@ -397,15 +796,11 @@ static DBusHandlerResult router_dbusif_routing_async_set_source_volume_handler(D
             dbus_message_unref(reply);
         }
         if ( u->dbusif->cb_routing_async_set_source_volume ) {
-            status = u->dbusif->cb_routing_async_set_source_volume(u, handle, source_id, volume, ramp_type, ramp_time);
-        }
-    } else {
-        if ( dbus_error_is_set(&error) == TRUE ) {
-            pa_log_error("%s: error while parsing the message '%s', %s: %s", __FILE__, name, error.name, error.message);
+            status = u->dbusif->cb_routing_async_set_source_volume(u, req.handle, req.source_id, req.volume, req.ramp_type,
+                    req.ramp_time);
         }
     }
 
-    dbus_error_free(&error);
     ROUTER_FUNCTION_EXIT;
     return result;
 }
@@ -419,16 +814,12 @@ static DBusHandlerResult router_dbusif_routing_async_set_source_volume_handler(D
  */
 static DBusHandlerResult router_dbusif_routing_async_set_source_state_handler(DBusConnection *conn, DBusMessage *msg,
         void *arg) {
-    DBusError error;
     DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    async_request_t req;
     dbus_bool_t success = FALSE;
     dbus_int16_t status = E_NOT_POSSIBLE;
     DBusMessage *reply = NULL;
 
-    uint16_t handle = 0;
-    uint16_t source_id = 0;
-    int32_t state = 0;
-
     struct userdata *u = (struct userdata *) arg;
     const char *name = dbus_message_get_member(msg);
     ROUTER_FUNCTION_ENTRY;
@@ -436,18 +827,7 @@ static DBusHandlerResult router_dbusif_routing_async_set_source_state_handler(DB
     pa_assert(msg);
     pa_assert(name);
 
-    dbus_error_init(&error);
-#ifdef GENIVI_DBUS_PLUGIN
-    success = dbus_message_get_args(msg, &error, DBUS_TYPE_UINT16, &handle, DBUS_TYPE_UINT16, &source_id,
-            DBUS_TYPE_INT32, &state, DBUS_TYPE_INVALID);
-#else
-    success = dbus_message_get_args(msg, &error,
-            DBUS_TYPE_UINT16, &handle,
-            DBUS_TYPE_UINT16, &source_id,
-            DBUS_TYPE_INT16, &state,
-            DBUS_TYPE_INVALID);
-#endif
-    if ( success == TRUE ) {
+    if ( decode_request(msg, &set_source_state_decoder, &req) ) {
         reply = dbus_message_new_method_return(msg);
         if ( reply ) {
             success = dbus_message_append_args(reply, DBUS_TYPE_UINT16, &status, DBUS_TYPE_INVALID);
@@ -461,17 +841,126 @@ static DBusHandlerResult router_dbusif_routing_async_set_source_state_handler(DB
             dbus_message_unref(reply);
         }
         if ( u->dbusif->cb_routing_async_set_source_state ) {
-            pa_log_error("source id = %d,source state = %d", source_id, state);
-            status = u->dbusif->cb_routing_async_set_source_state(u, handle, source_id, state);
+            pa_log_debug("source id = %d,source state = %d", req.source_id, req.state);
+            status = u->dbusif->cb_routing_async_set_source_state(u, req.handle, req.source_id, req.state);
         }
+    }
 
-    } else {
-        if ( dbus_error_is_set(&error) == TRUE ) {
-            pa_log_error("%s: error while parsing the message '%s', %s: %s", __FILE__, name, error.name, error.message);
+    ROUTER_FUNCTION_EXIT;
+    return result;
+}
+
+/*
+ * handle, then one (type, id, volume, ramp_type, ramp_time) struct per sink or source. This layout and the one of
+ * ackSetVolumes are defined by this module, they are not taken from the GENIVI routing interface definition.
+ */
+#define SET_VOLUMES_SIGNATURE "qa(qqnnq)"
+
+/**
+ * @brief Decodes the arguments of a batched set volumes request.
+ * The signature is checked once, then the elements are copied into a single array.
+ * @param msg: The dbus message.
+ *        handle: The request identifier to be filled.
+ *        count: The number of elements to be filled.
+ * @return am_volume_t*: The elements, to be freed with pa_xfree, NULL on failure.
+ */
+static am_volume_t* decode_volumes(DBusMessage *msg, uint16_t *handle, uint32_t *count) {
+    DBusMessageIter iter;
+    DBusMessageIter array;
+    DBusMessageIter element;
+    am_volume_t *volumes;
+    uint32_t n = 0;
+
+    pa_assert(msg);
+    pa_assert(handle);
+    pa_assert(count);
+
+    if ( dbus_message_has_signature(msg, SET_VOLUMES_SIGNATURE) == FALSE ) {
+        pa_log_error("%s: unexpected signature '%s' for message '%s', expected '%s'", __FILE__,
+                dbus_message_get_signature(msg), dbus_message_get_member(msg), SET_VOLUMES_SIGNATURE);
+        return NULL;
+    }
+    if ( dbus_message_iter_init(msg, &iter) == FALSE ) {
+        return NULL;
+    }
+    dbus_message_iter_get_basic(&iter, handle);
+    dbus_message_iter_next(&iter);
+
+    /* count first, so the elements land in one allocation */
+    dbus_message_iter_recurse(&iter, &array);
+    while ( dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_STRUCT ) {
+        n++;
+        dbus_message_iter_next(&array);
+    }
+    if ( n > AM_MAX_VOLUMES ) {
+        pa_log_error("%s: %u volumes in one request, the limit is %u", __FILE__, n, AM_MAX_VOLUMES);
+        return NULL;
+    }
+
+    volumes = pa_xnew0(am_volume_t, PA_MAX(n, 1U));
+    *count = 0;
+    dbus_message_iter_recurse(&iter, &array);
+    while ( dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_STRUCT ) {
+        am_volume_t *v = &volumes[(*count)++];
+        dbus_message_iter_recurse(&array, &element);
+        dbus_message_iter_get_basic(&element, &v->type);
+        dbus_message_iter_next(&element);
+        dbus_message_iter_get_basic(&element, &v->id);
+        dbus_message_iter_next(&element);
+        dbus_message_iter_get_basic(&element, &v->volume);
+        dbus_message_iter_next(&element);
+        dbus_message_iter_get_basic(&element, &v->ramp_type);
+        dbus_message_iter_next(&element);
+        dbus_message_iter_get_basic(&element, &v->ramp_time);
+        dbus_message_iter_next(&array);
+    }
+    return volumes;
+}
+
+/**
+ * @brief The async set volumes handler, the volumes of several sinks and sources are set by one request and
+ * acknowledged by one ack.
+ * @param conn: The dbus connection pointer.
+ *        msg: The dbus message.
+ *        args: The pointer which was registered while registering this function, The userdata.
+ * @return DBusHandlerResult
+ */
+static DBusHandlerResult router_dbusif_routing_async_set_volumes_handler(DBusConnection *conn, DBusMessage *msg,
+        void *arg) {
+    DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    am_volume_t *volumes;
+    uint16_t handle = 0;
+    uint32_t count = 0;
+    dbus_bool_t success = FALSE;
+    dbus_int16_t status = E_NOT_POSSIBLE;
+    DBusMessage *reply = NULL;
+
+    struct userdata *u = (struct userdata *) arg;
+    const char *name = dbus_message_get_member(msg);
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
+    pa_assert(msg);
+    pa_assert(name);
+
+    if ( (volumes = decode_volumes(msg, &handle, &count)) != NULL ) {
+        reply = dbus_message_new_method_return(msg);
+        if ( reply ) {
+            success = dbus_message_append_args(reply, DBUS_TYPE_UINT16, &status, DBUS_TYPE_INVALID);
+            if ( success == TRUE ) {
+                success = dbus_connection_send(conn, reply, NULL);
+                if ( success == TRUE ) {
+                    result = DBUS_HANDLER_RESULT_HANDLED;
+                    pa_log_debug("%s: handled message '%s' with %u volumes", __FILE__, name, count);
+                }
+            }
+            dbus_message_unref(reply);
         }
+        if ( u->dbusif->cb_routing_async_set_volumes ) {
+            status = u->dbusif->cb_routing_async_set_volumes(u, handle, volumes, count);
+        }
+        pa_xfree(volumes);
     }
 
-    dbus_error_free(&error);
     ROUTER_FUNCTION_EXIT;
     return result;
 }
@@ -569,75 +1058,580 @@ static DBusHandlerResult router_dbusif_command_cb_removed_connection_handler(DBu
         if ( u->dbusif->cb_removed_main_connection ) {
             u->dbusif->cb_removed_main_connection(u, main_connection);
         }
-        reply = dbus_message_new_method_return(msg);
-        if ( reply ) {
-            success = dbus_connection_send(conn, reply, NULL);
-            if ( success == TRUE ) {
-                result = DBUS_HANDLER_RESULT_HANDLED;
-                pa_log_debug("%s: handled message '%s'", __FILE__, name);
-            }
-            dbus_message_unref(reply);
+        reply = dbus_message_new_method_return(msg);
+        if ( reply ) {
+            success = dbus_connection_send(conn, reply, NULL);
+            if ( success == TRUE ) {
+                result = DBUS_HANDLER_RESULT_HANDLED;
+                pa_log_debug("%s: handled message '%s'", __FILE__, name);
+            }
+            dbus_message_unref(reply);
+        }
+    } else {
+        if ( dbus_error_is_set(&error) == TRUE ) {
+            pa_log_error("%s: error while parsing the message '%s', %s: %s", __FILE__, name, error.name, error.message);
+        }
+    }
+
+    dbus_error_free(&error);
+    ROUTER_FUNCTION_EXIT;
+    return result;
+}
+
+/**
+ * @brief The command side connection state change notification handler
+ * @param conn: The dbus connection pointer.
+ *        msg: The dbus message.
+ *        args: The pointer which was registered while registering this function, The userdata.
+ * @return DBusHandlerResult
+ */
+static DBusHandlerResult router_dbusif_command_cb_connection_state_changed_handler(DBusConnection *conn,
+        DBusMessage *msg, void *arg) {
+    DBusError error;
+    DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    dbus_bool_t success = FALSE;
+    uint16_t main_connection = 0;
+    int16_t state = 0;
+    DBusMessage *reply = NULL;
+
+    struct userdata *u = (struct userdata *) arg;
+    const char *name = dbus_message_get_member(msg);
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
+    pa_assert(msg);
+    pa_assert(name);
+
+    dbus_error_init(&error);
+    success = dbus_message_get_args(msg, &error, DBUS_TYPE_UINT16, &main_connection, DBUS_TYPE_INT16, &state,
+            DBUS_TYPE_INVALID);
+
+    if ( success == TRUE ) {
+        if ( u->dbusif->cb_main_connection_state_changed ) {
+            u->dbusif->cb_main_connection_state_changed(u, main_connection, (int32_t) state);
+        }
+        reply = dbus_message_new_method_return(msg);
+        if ( reply ) {
+            success = dbus_connection_send(conn, reply, NULL);
+            if ( success == TRUE ) {
+                result = DBUS_HANDLER_RESULT_HANDLED;
+                pa_log_debug("%s: handled message '%s'", __FILE__, name);
+            }
+            dbus_message_unref(reply);
+        }
+    } else {
+        if ( dbus_error_is_set(&error) == TRUE ) {
+            pa_log_error("%s: error while parsing the message '%s', %s: %s", __FILE__, name, error.name, error.message);
+        }
+    }
+
+    dbus_error_free(&error);
+    ROUTER_FUNCTION_EXIT;
+    return result;
+}
+
+/**
+ * @brief The handler for the command side element signals NewSink/NewSource (the element struct, which starts
+ * with the id and the name) and RemovedSink/RemovedSource (the id only).
+ * @param conn: The dbus connection pointer.
+ *        msg: The dbus message.
+ *        args: The userdata.
+ * @return DBusHandlerResult
+ */
+static DBusHandlerResult router_dbusif_command_cb_element_changed_handler(DBusConnection *conn, DBusMessage *msg,
+        void *arg) {
+    DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    DBusMessageIter iter;
+    DBusMessageIter element_iter;
+    DBusMessageIter *field = &iter;
+    dbus_uint16_t id = 0;
+    const char *element_name = NULL;
+    cb_element_changed_t cb = NULL;
+
+    struct userdata *u = (struct userdata *) arg;
+    const char *name = dbus_message_get_member(msg);
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
+    pa_assert(msg);
+    pa_assert(name);
+
+    if ( !strcmp(name, "NewSink") ) {
+        cb = u->dbusif->cb_new_sink;
+    } else if ( !strcmp(name, "NewSource") ) {
+        cb = u->dbusif->cb_new_source;
+    } else if ( !strcmp(name, "RemovedSink") ) {
+        cb = u->dbusif->cb_removed_sink;
+    } else if ( !strcmp(name, "RemovedSource") ) {
+        cb = u->dbusif->cb_removed_source;
+    }
+
+    do {
+        if ( dbus_message_iter_init(msg, &iter) == FALSE ) {
+            break;
+        }
+        if ( dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_STRUCT ) {
+            dbus_message_iter_recurse(&iter, &element_iter);
+            field = &element_iter;
+        }
+        if ( dbus_message_iter_get_arg_type(field) != DBUS_TYPE_UINT16 ) {
+            pa_log_error("%s: error while parsing the message '%s'", __FILE__, name);
+            break;
+        }
+        dbus_message_iter_get_basic(field, &id);
+        if ( (dbus_message_iter_next(field) == TRUE) && (dbus_message_iter_get_arg_type(field) == DBUS_TYPE_STRING) ) {
+            dbus_message_iter_get_basic(field, &element_name);
+        }
+        pa_log_debug("%s: '%s' id=%u name=%s", __FILE__, name, id, element_name ? element_name : "");
+        if ( cb ) {
+            cb(u, id, element_name);
+        }
+        result = DBUS_HANDLER_RESULT_HANDLED;
+    } while ( 0 );
+
+    ROUTER_FUNCTION_EXIT;
+    return result;
+}
+
+/**
+ * @brief The handler for the bus NameOwnerChanged signal, reports when the audiomanager appears or vanishes.
+ * @param conn: The dbus connection pointer.
+ *        msg: The dbus message.
+ *        args: The userdata.
+ * @return DBusHandlerResult
+ */
+static DBusHandlerResult router_dbusif_name_owner_changed_handler(DBusConnection *conn, DBusMessage *msg,
+        void *arg) {
+    const char *bus_name = NULL;
+    const char *old_owner = NULL;
+    const char *new_owner = NULL;
+
+    struct userdata *u = (struct userdata *) arg;
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
+    pa_assert(msg);
+
+    if ( (dbus_message_is_signal(msg, DBUS_INTERFACE_DBUS, "NameOwnerChanged") == TRUE)
+            && (dbus_message_get_args(msg, NULL, DBUS_TYPE_STRING, &bus_name, DBUS_TYPE_STRING, &old_owner,
+                    DBUS_TYPE_STRING, &new_owner, DBUS_TYPE_INVALID) == TRUE)
+            && (strcmp(bus_name, u->dbusif->am_routing_dbus_name) == 0) ) {
+        pa_log_info("%s: owner of %s changed '%s' -> '%s'", __FILE__, bus_name, old_owner, new_owner);
+        MODULE_ROUTER_FREE(u->dbusif->am_owner);
+        u->dbusif->am_owner = (*new_owner != '\0') ? pa_xstrdup(new_owner) : NULL;
+        if ( *new_owner == '\0' ) {
+            ring_close(u);
+        }
+        /* a restarted audiomanager listens on its peer address again, reconnect before registering */
+        if ( (*new_owner != '\0') && u->dbusif->am_address && (u->dbusif->peer == NULL) ) {
+            peer_open(u);
+        }
+        if ( u->dbusif->cb_am_owner_changed ) {
+            u->dbusif->cb_am_owner_changed(u, (*new_owner != '\0'));
+        }
+    }
+
+    ROUTER_FUNCTION_EXIT;
+    /* other filters on the connection may be watching this signal too */
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+/**
+ * @brief This function releases a message template.
+ * @param p: The template message.
+ * @return void
+ */
+static void template_free(void *p) {
+    dbus_message_unref((DBusMessage*) p);
+}
+
+/**
+ * @brief This function builds the method call headers of a member table, so the requests and acks only copy them.
+ * @param destination: The destination bus name.
+ *        path: The object path.
+ *        interface: The interface name.
+ *        tbl: The member names, terminated by NULL.
+ * @return pa_hashmap*: The hash map from member name to template message.
+ */
+static pa_hashmap* template_map_new(const char *destination, const char *path, const char *interface,
+        const char *const *tbl) {
+    const char *const *member;
+    DBusMessage *tmpl;
+    pa_hashmap *map = pa_hashmap_new_full(pa_idxset_string_hash_func, pa_idxset_string_compare_func, NULL,
+            template_free);
+    for ( member = tbl; *member; member++ ) {
+        tmpl = dbus_message_new_method_call(destination, path, interface, *member);
+        if ( tmpl ) {
+            pa_hashmap_put(map, (void*) *member, tmpl);
+        }
+    }
+    return map;
+}
+
+/**
+ * @brief This function returns a new method call message, copied from the template of the member when there is one.
+ * Only the arguments remain to be appended by the caller.
+ * @param templates: The templates of the interface.
+ *        destination: The destination bus name.
+ *        path: The object path.
+ *        interface: The interface name.
+ *        member: The method name.
+ * @return DBusMessage*: The new message, NULL on failure.
+ */
+static DBusMessage* new_message_from_template(pa_hashmap *templates, const char *destination, const char *path,
+        const char *interface, const char *member) {
+    DBusMessage *tmpl;
+
+    tmpl = pa_hashmap_get(templates, member);
+    if ( tmpl == NULL ) {
+        return dbus_message_new_method_call(destination, path, interface, member);
+    }
+    return dbus_message_copy(tmpl);
+}
+
+/**
+ * @brief This function returns a new routing side method call message.
+ * @param dbusif: The dbus interface data.
+ *        member: The method name.
+ * @return DBusMessage*: The new message, NULL on failure.
+ */
+static DBusMessage* new_routing_message(router_dbusif *dbusif, const char *member) {
+    return new_message_from_template(dbusif->routing_templates, dbusif->am_routing_dbus_name,
+            dbusif->am_routing_dbus_path, dbusif->am_routing_dbus_interface_name, member);
+}
+
+/**
+ * @brief This function returns a new command side method call message.
+ * @param dbusif: The dbus interface data.
+ *        member: The method name.
+ * @return DBusMessage*: The new message, NULL on failure.
+ */
+static DBusMessage* new_command_message(router_dbusif *dbusif, const char *member) {
+    return new_message_from_template(dbusif->command_templates, dbusif->am_command_dbus_name,
+            dbusif->am_command_dbus_path, dbusif->am_command_dbus_interface_name, member);
+}
+
+/**
+ * @brief This function returns the connection which carries the traffic to the given audiomanager interface, the
+ * peer connection for the routing interface while it is up and the system bus otherwise.
+ * @param routerif: The router interface structure.
+ *        interface: The interface of the message.
+ * @return DBusConnection*: The connection to send the message on.
+ */
+static DBusConnection* connection_for(router_dbusif *routerif, const char *interface) {
+    if ( routerif->peer && interface && !strcmp(interface, routerif->am_routing_dbus_interface_name) ) {
+        return pa_dbus_wrap_connection_get(routerif->peer);
+    }
+    return pa_dbus_connection_get(routerif->conn);
+}
+
+/**
+ * @brief This function tears the peer connection down, the routing traffic falls back to the system bus.
+ * @param u: The user data of the module.
+ * @return void
+ */
+static void peer_close(struct userdata *u) {
+    router_dbusif *routerif = u->dbusif;
+    DBusConnection *conn;
+
+    if ( routerif->peer_close_event ) {
+        u->core->mainloop->defer_free(routerif->peer_close_event);
+        routerif->peer_close_event = NULL;
+    }
+    if ( routerif->peer == NULL ) {
+        return;
+    }
+    conn = pa_dbus_wrap_connection_get(routerif->peer);
+    dbus_connection_remove_filter(conn, peer_filter, u);
+    dbus_connection_remove_filter(conn, router_dbusif_signal_filter, u);
+    dbus_connection_unregister_object_path(conn, routerif->pulse_router_dbus_path);
+    pa_dbus_wrap_connection_free(routerif->peer);
+    routerif->peer = NULL;
+}
+
+/**
+ * @brief The deferred event which closes a peer connection after it was lost, it can not be freed from the filter
+ * of the connection itself.
+ * @param m: The main loop api.
+ *        e: The deferred event.
+ *        userdata: The user data of the module.
+ * @return void
+ */
+static void peer_close_cb(pa_mainloop_api *m, pa_defer_event *e, void *userdata) {
+    struct userdata *u = (struct userdata *) userdata;
+
+    pa_assert(u);
+    peer_close(u);
+}
+
+/**
+ * @brief The filter of the peer connection, it notices when the audiomanager goes away.
+ * @param conn: The dbus connection pointer.
+ *        msg: The dbus message.
+ *        args: The pointer which was registered while registering this function, The userdata.
+ * @return DBusHandlerResult
+ */
+static DBusHandlerResult peer_filter(DBusConnection *conn, DBusMessage *msg, void *arg) {
+    struct userdata *u = (struct userdata *) arg;
+
+    pa_assert(u);
+    if ( dbus_message_is_signal(msg, DBUS_INTERFACE_LOCAL, "Disconnected") == TRUE ) {
+        pa_log_warn("%s: peer connection to %s lost, routing over the system bus", __FILE__, u->dbusif->am_address);
+        if ( u->dbusif->peer_close_event == NULL ) {
+            u->dbusif->peer_close_event = u->core->mainloop->defer_new(u->core->mainloop, peer_close_cb, u);
+        }
+        return DBUS_HANDLER_RESULT_HANDLED;
+    }
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+/**
+ * @brief This function opens the peer to peer connection to the audiomanager. The router object and the dispatch
+ * tables are served on it exactly as on the system bus.
+ * @param u: The user data of the module.
+ * @return bool true on success.
+ */
+static bool peer_open(struct userdata *u) {
+    router_dbusif *routerif = u->dbusif;
+    DBusError error;
+    DBusConnection *conn;
+
+    pa_assert(routerif->am_address);
+    dbus_error_init(&error);
+    conn = dbus_connection_open_private(routerif->am_address, &error);
+    if ( (conn == NULL) || (dbus_error_is_set(&error) == TRUE) ) {
+        pa_log_warn("%s: failed to connect to '%s': %s: %s", __FILE__, routerif->am_address, error.name,
+                error.message);
+        dbus_error_free(&error);
+        if ( conn ) {
+            dbus_connection_unref(conn);
+        }
+        return false;
+    }
+    dbus_connection_set_exit_on_disconnect(conn, FALSE);
+    routerif->peer = pa_dbus_wrap_connection_new_from_private(u->core->mainloop, true, conn);
+    dbus_connection_unref(conn);
+    conn = pa_dbus_wrap_connection_get(routerif->peer);
+
+    dbus_connection_register_object_path(conn, routerif->pulse_router_dbus_path, &router_object_vtable, u);
+    dbus_connection_add_filter(conn, peer_filter, u, NULL);
+    dbus_connection_add_filter(conn, router_dbusif_signal_filter, u, NULL);
+    pa_log_info("%s: routing over the peer connection to '%s'", __FILE__, routerif->am_address);
+    return true;
+}
+
+/**
+ * @brief This function closes the command ring, the volume commands and acks go over D-Bus again.
+ * @param u: The user data of the module.
+ * @return void
+ */
+static void ring_close(struct userdata *u) {
+#ifdef HAVE_MEMFD
+    router_dbusif *routerif = u->dbusif;
+
+    if ( routerif->ring_event ) {
+        u->core->mainloop->io_free(routerif->ring_event);
+        routerif->ring_event = NULL;
+    }
+    if ( routerif->ring ) {
+        router_ring_free(routerif->ring);
+        routerif->ring = NULL;
+        pa_log_info("%s: command ring closed", __FILE__);
+    }
+#endif
+}
+
+/**
+ * @brief This function puts the ack of a command taken from the ring on the ack ring. Acks of commands which came
+ * over D-Bus, or which do not fit on the ring, are left to D-Bus.
+ * @param u: The user data of the module.
+ *        type: The type of the command which is acked.
+ *        handle: The identifier of the command.
+ *        volume: The new volume.
+ *        error: The error status of the command.
+ * @return bool true if the ack was put on the ring.
+ */
+static bool ring_ack(struct userdata *u, uint16_t type, uint16_t handle, int16_t volume, uint16_t error) {
+#ifdef HAVE_MEMFD
+    router_dbusif *routerif = u->dbusif;
+    router_ring_ack ack;
+
+    if ( (routerif->ring == NULL) || !routerif->ring_dispatching ) {
+        return false;
+    }
+    ack.type = type;
+    ack.handle = handle;
+    ack.volume = volume;
+    ack.error = error;
+    if ( router_ring_push_ack(routerif->ring, &ack) ) {
+        routerif->ring_acks++;
+        return true;
+    }
+    pa_log_warn("%s: ack ring full, acking handle %u over D-Bus", __FILE__, handle);
+#endif
+    return false;
+}
+
+#ifdef HAVE_MEMFD
+/**
+ * @brief The command doorbell handler, it drains the command ring and rings the ack doorbell once for all the acks.
+ * @param m: The main loop api.
+ *        e: The io event.
+ *        fd: The command doorbell.
+ *        events: The events which occurred.
+ *        userdata: The user data of the module.
+ * @return void
+ */
+static void ring_io_cb(pa_mainloop_api *m, pa_io_event *e, int fd, pa_io_event_flags_t events, void *userdata) {
+    struct userdata *u = (struct userdata *) userdata;
+    router_dbusif *routerif;
+    router_ring_cmd cmd;
+
+    pa_assert(u);
+    pa_assert_se((routerif = u->dbusif));
+    pa_assert(routerif->ring);
+
+    router_ring_clear_cmd_doorbell(routerif->ring);
+    routerif->ring_dispatching = true;
+    while ( routerif->ring && router_ring_pop_cmd(routerif->ring, &cmd) ) {
+        switch ( cmd.type ) {
+            case RING_CMD_SET_SINK_VOLUME:
+                if ( routerif->cb_routing_async_set_sink_volume ) {
+                    routerif->cb_routing_async_set_sink_volume(u, cmd.handle, cmd.id, cmd.volume, cmd.ramp_type,
+                            cmd.ramp_time);
+                }
+                break;
+            case RING_CMD_SET_SOURCE_VOLUME:
+                if ( routerif->cb_routing_async_set_source_volume ) {
+                    routerif->cb_routing_async_set_source_volume(u, cmd.handle, cmd.id, cmd.volume, cmd.ramp_type,
+                            cmd.ramp_time);
+                }
+                break;
+            default:
+                pa_log_warn("%s: unknown ring command %u, handle %u", __FILE__, cmd.type, cmd.handle);
+                break;
+        }
+    }
+    routerif->ring_dispatching = false;
+    if ( routerif->ring && routerif->ring_acks ) {
+        router_ring_ring_ack_doorbell(routerif->ring);
+        routerif->ring_acks = 0;
+    }
+}
+#endif
+
+/**
+ * @brief This function checks that a ring request comes from the audiomanager, either over the peer connection or
+ * from the current owner of the audiomanager routing name on the system bus.
+ * @param routerif: The router interface structure.
+ *        conn: The dbus connection pointer.
+ *        msg: The dbus message.
+ * @return bool true if the request comes from the audiomanager.
+ */
+static bool from_audiomanager(router_dbusif *routerif, DBusConnection *conn, DBusMessage *msg) {
+    const char *sender;
+
+    if ( routerif->peer && (conn == pa_dbus_wrap_connection_get(routerif->peer)) ) {
+        return true;
+    }
+    sender = dbus_message_get_sender(msg);
+    return (routerif->am_owner != NULL) && (sender != NULL) && !strcmp(sender, routerif->am_owner);
+}
+
+/**
+ * @brief The open ring request handler. The audiomanager asks for the command ring and gets the shared memory and
+ * the two doorbells as unix fds, if the ring can not be offered it keeps using D-Bus. Only the audiomanager may open
+ * the ring and only while none is open, a second request does not take the live ring away from it.
+ * @param conn: The dbus connection pointer.
+ *        msg: The dbus message.
+ *        args: The pointer which was registered while registering this function, The userdata.
+ * @return DBusHandlerResult
+ */
+static DBusHandlerResult router_dbusif_routing_open_ring_handler(DBusConnection *conn, DBusMessage *msg, void *arg) {
+    struct userdata *u = (struct userdata *) arg;
+    DBusMessage *reply = NULL;
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
+    pa_assert(msg);
+
+#ifdef HAVE_MEMFD
+    do {
+        router_dbusif *routerif = u->dbusif;
+        int memfd;
+        int cmd_fd;
+        int ack_fd;
+        dbus_uint32_t slots;
+
+        if ( !from_audiomanager(routerif, conn, msg) ) {
+            pa_log_warn("%s: '%s' from %s refused", __FILE__, dbus_message_get_member(msg),
+                    pa_strnull(dbus_message_get_sender(msg)));
+            reply = dbus_message_new_error(msg, DBUS_ERROR_ACCESS_DENIED, "only the audiomanager may open the ring");
+            break;
+        }
+        if ( routerif->ring ) {
+            reply = dbus_message_new_error(msg, DBUS_ERROR_FAILED, "the command ring is already open");
+            break;
         }
-    } else {
-        if ( dbus_error_is_set(&error) == TRUE ) {
-            pa_log_error("%s: error while parsing the message '%s', %s: %s", __FILE__, name, error.name, error.message);
+        if ( dbus_connection_can_send_type(conn, DBUS_TYPE_UNIX_FD) == FALSE ) {
+            reply = dbus_message_new_error(msg, DBUS_ERROR_NOT_SUPPORTED, "the connection can not pass unix fds");
+            break;
         }
+        if ( (routerif->ring = router_ring_new(ROUTER_RING_SLOTS)) == NULL ) {
+            reply = dbus_message_new_error(msg, DBUS_ERROR_FAILED, "failed to create the command ring");
+            break;
+        }
+        memfd = router_ring_memfd(routerif->ring);
+        cmd_fd = router_ring_cmd_doorbell(routerif->ring);
+        ack_fd = router_ring_ack_doorbell(routerif->ring);
+        slots = router_ring_slots(routerif->ring);
+        reply = dbus_message_new_method_return(msg);
+        if ( (reply == NULL)
+                || (dbus_message_append_args(reply, DBUS_TYPE_UNIX_FD, &memfd, DBUS_TYPE_UNIX_FD, &cmd_fd,
+                        DBUS_TYPE_UNIX_FD, &ack_fd, DBUS_TYPE_UINT32, &slots, DBUS_TYPE_INVALID) == FALSE) ) {
+            pa_log_error("%s: failed to build the reply of '%s'", __FILE__, dbus_message_get_member(msg));
+            ring_close(u);
+            break;
+        }
+        routerif->ring_event = u->core->mainloop->io_new(u->core->mainloop, cmd_fd, PA_IO_EVENT_INPUT, ring_io_cb,
+                u);
+        pa_log_info("%s: command ring of %u slots opened", __FILE__, slots);
+    } while ( 0 );
+#else
+    reply = dbus_message_new_error(msg, DBUS_ERROR_NOT_SUPPORTED, "the command ring is not built in");
+#endif
+    if ( reply ) {
+        dbus_connection_send(conn, reply, NULL);
+        dbus_message_unref(reply);
     }
-
-    dbus_error_free(&error);
     ROUTER_FUNCTION_EXIT;
-    return result;
+    return DBUS_HANDLER_RESULT_HANDLED;
 }
 
 /**
- * @brief The command side connection state change notification handler
+ * @brief The close ring request handler.
  * @param conn: The dbus connection pointer.
  *        msg: The dbus message.
  *        args: The pointer which was registered while registering this function, The userdata.
  * @return DBusHandlerResult
  */
-static DBusHandlerResult router_dbusif_command_cb_connection_state_changed_handler(DBusConnection *conn,
-        DBusMessage *msg, void *arg) {
-    DBusError error;
-    DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    dbus_bool_t success = FALSE;
-    uint16_t main_connection = 0;
-    int16_t state = 0;
-    DBusMessage *reply = NULL;
-
+static DBusHandlerResult router_dbusif_routing_close_ring_handler(DBusConnection *conn, DBusMessage *msg, void *arg) {
     struct userdata *u = (struct userdata *) arg;
-    const char *name = dbus_message_get_member(msg);
+    DBusMessage *reply;
     ROUTER_FUNCTION_ENTRY;
     pa_assert(u);
     pa_assert(msg);
-    pa_assert(name);
-
-    dbus_error_init(&error);
-    success = dbus_message_get_args(msg, &error, DBUS_TYPE_UINT16, &main_connection, DBUS_TYPE_INT16, &state,
-            DBUS_TYPE_INVALID);
 
-    if ( success == TRUE ) {
-        if ( u->dbusif->cb_main_connection_state_changed ) {
-            u->dbusif->cb_main_connection_state_changed(u, main_connection, (int32_t) state);
-        }
+    if ( from_audiomanager(u->dbusif, conn, msg) ) {
+        ring_close(u);
         reply = dbus_message_new_method_return(msg);
-        if ( reply ) {
-            success = dbus_connection_send(conn, reply, NULL);
-            if ( success == TRUE ) {
-                result = DBUS_HANDLER_RESULT_HANDLED;
-                pa_log_debug("%s: handled message '%s'", __FILE__, name);
-            }
-            dbus_message_unref(reply);
-        }
     } else {
-        if ( dbus_error_is_set(&error) == TRUE ) {
-            pa_log_error("%s: error while parsing the message '%s', %s: %s", __FILE__, name, error.name, error.message);
-        }
+        pa_log_warn("%s: '%s' from %s refused", __FILE__, dbus_message_get_member(msg),
+                pa_strnull(dbus_message_get_sender(msg)));
+        reply = dbus_message_new_error(msg, DBUS_ERROR_ACCESS_DENIED, "only the audiomanager may close the ring");
+    }
+    if ( reply != NULL ) {
+        dbus_connection_send(conn, reply, NULL);
+        dbus_message_unref(reply);
     }
-
-    dbus_error_free(&error);
     ROUTER_FUNCTION_EXIT;
-    return result;
+    return DBUS_HANDLER_RESULT_HANDLED;
 }
 
 /**
@@ -647,10 +1641,10 @@ static DBusHandlerResult router_dbusif_command_cb_connection_state_changed_handl
  * @return router_dbusif
  */
 router_dbusif *router_dbusif_init(struct userdata *u, router_init_data_t* init_data) {
-    static const DBusObjectPathVTable vtable = { .message_function = router_dbusif_method_handler, };
-
     DBusError error;
     DBusConnection *dbusconn;
+    DBusMessage *msg;
+    char **rule;
     int result;
     ROUTER_FUNCTION_ENTRY;
     router_dbusif* routerif = pa_xnew0(router_dbusif, 1);
@@ -658,7 +1652,7 @@ router_dbusif *router_dbusif_init(struct userdata *u, router_init_data_t* init_d
         return routerif;
     }
 
-    PA_LLIST_HEAD_INIT(pending_dbus_calls_t, routerif->pending_call_list);
+    PA_LLIST_HEAD_INIT(pending_dbus_calls_t, routerif->free_calls);
 
     routerif->pulse_router_dbus_return_interface_name = pa_xstrdup(init_data->pulse_router_dbus_return_interface_name);
     routerif->pulse_router_dbus_name = pa_xstrdup(init_data->pulse_router_dbus_name);
@@ -670,7 +1664,10 @@ router_dbusif *router_dbusif_init(struct userdata *u, router_init_data_t* init_d
     routerif->am_routing_dbus_name = pa_xstrdup(init_data->am_routing_dbus_name);
     routerif->am_routing_dbus_interface_name = pa_xstrdup(init_data->am_routing_dbus_interface_name);
     routerif->am_routing_dbus_path = pa_xstrdup(init_data->am_routing_dbus_path);
-    routerif->am_watch_rule = pa_xstrdup(init_data->am_watch_rule);
+    routerif->am_watch_rules = watch_rules_new(routerif);
+    routerif->am_address = pa_xstrdup(init_data->am_address);
+    routerif->am_owner_rule = pa_sprintf_malloc("type='signal',sender='" DBUS_SERVICE_DBUS "',interface='"
+            DBUS_INTERFACE_DBUS "',member='NameOwnerChanged',arg0='%s'", init_data->am_routing_dbus_name);
 
     /* store callbacks in userdata */
     routerif->cb_new_main_connection = init_data->cb_new_main_connection;
@@ -689,10 +1686,31 @@ router_dbusif *router_dbusif_init(struct userdata *u, router_init_data_t* init_d
     routerif->cb_routing_async_set_sink_volume = init_data->cb_routing_async_set_sink_volume;
     routerif->cb_routing_async_set_source_volume = init_data->cb_routing_async_set_source_volume;
     routerif->cb_routing_async_set_source_state = init_data->cb_routing_async_set_source_state;
+    routerif->cb_routing_async_set_volumes = init_data->cb_routing_async_set_volumes;
     routerif->cb_routing_peek_source_reply = init_data->cb_routing_peek_source_reply;
     routerif->cb_routing_peek_sink_reply = init_data->cb_routing_peek_sink_reply;
     routerif->cb_routing_get_domain_of_source_reply = init_data->cb_routing_get_domain_of_source_reply;
     routerif->cb_routing_get_domain_of_sink_reply = init_data->cb_routing_get_domain_of_sink_reply;
+    routerif->cb_routing_register_batch_done = init_data->cb_routing_register_batch_done;
+    routerif->cb_new_sink = init_data->cb_new_sink;
+    routerif->cb_new_source = init_data->cb_new_source;
+    routerif->cb_removed_sink = init_data->cb_removed_sink;
+    routerif->cb_removed_source = init_data->cb_removed_source;
+    routerif->cb_am_owner_changed = init_data->cb_am_owner_changed;
+    routerif->batch = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+    routerif->inflight = pa_hashmap_new(pa_idxset_string_hash_func, pa_idxset_string_compare_func);
+    routerif->routing_templates = template_map_new(routerif->am_routing_dbus_name, routerif->am_routing_dbus_path,
+            routerif->am_routing_dbus_interface_name, routing_members_tbl);
+    routerif->command_templates = template_map_new(routerif->am_command_dbus_name, routerif->am_command_dbus_path,
+            routerif->am_command_dbus_interface_name, command_members_tbl);
+    routerif->method_dispatch = dispatch_map_new(method_dispatch_tbl);
+    routerif->signal_dispatch = dispatch_map_new(signal_dispatch_tbl);
+    routerif->calls = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+    routerif->reply_timeout = init_data->reply_timeout ? init_data->reply_timeout : AM_REPLY_TIMEOUT_DEFAULT;
+    routerif->deadlines = deadline_map_new(routerif->reply_timeout);
+    routerif->acks = pa_queue_new();
+    routerif->ack_event = u->core->mainloop->defer_new(u->core->mainloop, ack_event_cb, u);
+    u->core->mainloop->defer_enable(routerif->ack_event, 0);
 
     dbus_error_init(&error);
     routerif->conn = pa_dbus_bus_get(u->core, DBUS_BUS_SYSTEM, &error);
@@ -713,10 +1731,32 @@ router_dbusif *router_dbusif_init(struct userdata *u, router_init_data_t* init_d
 
     pa_log_debug("%s: now owner of '%s' D-Bus name on system bus", __FILE__, routerif->pulse_router_dbus_name);
 
-    dbus_connection_register_object_path(dbusconn, routerif->pulse_router_dbus_path, &vtable, u);
+    dbus_connection_register_object_path(dbusconn, routerif->pulse_router_dbus_path, &router_object_vtable, u);
+
+    for ( rule = routerif->am_watch_rules; *rule; rule++ ) {
+        dbus_bus_add_match(dbusconn, *rule, NULL);
+    }
+    dbus_bus_add_match(dbusconn, routerif->am_owner_rule, NULL);
+    dbus_connection_add_filter(dbusconn, router_dbusif_signal_filter, u, NULL);
+
+    /* the requests below need u->dbusif, which is otherwise only set once this function returns */
+    u->dbusif = routerif;
+    /* an audiomanager which is already running sends no NameOwnerChanged, ask the bus for its unique name */
+    if ( (msg = dbus_message_new_method_call(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS,
+            "GetNameOwner")) != NULL ) {
+        if ( (dbus_message_append_args(msg, DBUS_TYPE_STRING, &routerif->am_routing_dbus_name,
+                DBUS_TYPE_INVALID) == FALSE)
+                || !send_message_with_reply(u, msg, router_dbusif_get_name_owner_reply_cb, NULL) ) {
+            pa_log_warn("%s: failed to ask for the owner of '%s'", __FILE__, routerif->am_routing_dbus_name);
+        }
+        dbus_message_unref(msg);
+    }
 
-    dbus_bus_add_match(dbusconn, routerif->am_watch_rule, &error);
-    dbus_connection_add_filter(dbusconn, router_dbusif_method_handler, u, NULL);
+    if ( routerif->am_address ) {
+        if ( peer_open(u) == false ) {
+            pa_log_warn("%s: routing over the system bus", __FILE__);
+        }
+    }
     ROUTER_FUNCTION_EXIT;
     return routerif;
 
@@ -731,7 +1771,19 @@ router_dbusif *router_dbusif_init(struct userdata *u, router_init_data_t* init_d
     MODULE_ROUTER_FREE(routerif->am_routing_dbus_name);
     MODULE_ROUTER_FREE(routerif->am_routing_dbus_interface_name);
     MODULE_ROUTER_FREE(routerif->am_routing_dbus_path);
-    MODULE_ROUTER_FREE(routerif->am_watch_rule);
+    watch_rules_free(routerif->am_watch_rules);
+    MODULE_ROUTER_FREE(routerif->am_owner_rule);
+    MODULE_ROUTER_FREE(routerif->am_address);
+    pa_hashmap_free(routerif->batch);
+    pa_hashmap_free(routerif->inflight);
+    pa_hashmap_free(routerif->routing_templates);
+    pa_hashmap_free(routerif->command_templates);
+    pa_hashmap_free(routerif->method_dispatch);
+    pa_hashmap_free(routerif->signal_dispatch);
+    pa_hashmap_free(routerif->calls);
+    pa_hashmap_free(routerif->deadlines);
+    u->core->mainloop->defer_free(routerif->ack_event);
+    pa_queue_free(routerif->acks, NULL);
     MODULE_ROUTER_FREE(routerif);
     dbus_error_free(&error);
     return NULL;
@@ -757,7 +1809,28 @@ void router_dbusif_done(struct userdata *u) {
     MODULE_ROUTER_FREE(routerif->am_routing_dbus_name);
     MODULE_ROUTER_FREE(routerif->am_routing_dbus_interface_name);
     MODULE_ROUTER_FREE(routerif->am_routing_dbus_path);
-    MODULE_ROUTER_FREE(routerif->am_watch_rule);
+    watch_rules_free(routerif->am_watch_rules);
+    MODULE_ROUTER_FREE(routerif->am_owner_rule);
+    MODULE_ROUTER_FREE(routerif->am_owner);
+    MODULE_ROUTER_FREE(routerif->am_address);
+    if ( routerif->batch ) {
+        pa_hashmap_free(routerif->batch);
+    }
+    if ( routerif->inflight ) {
+        pa_hashmap_free(routerif->inflight);
+    }
+    if ( routerif->routing_templates ) {
+        pa_hashmap_free(routerif->routing_templates);
+    }
+    if ( routerif->command_templates ) {
+        pa_hashmap_free(routerif->command_templates);
+    }
+    if ( routerif->method_dispatch ) {
+        pa_hashmap_free(routerif->method_dispatch);
+    }
+    if ( routerif->signal_dispatch ) {
+        pa_hashmap_free(routerif->signal_dispatch);
+    }
     MODULE_ROUTER_FREE(routerif);
 
     ROUTER_FUNCTION_EXIT;
@@ -782,8 +1855,7 @@ int router_dbusif_command_connect(struct userdata *u, am_main_connection_t* conn
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_command_dbus_name, dbusif->am_command_dbus_path,
-                dbusif->am_command_dbus_interface_name, "Connect");
+        dbus_request = new_command_message(dbusif, "Connect");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -834,8 +1906,7 @@ int router_dbusif_command_disconnect(struct userdata *u, am_disconnect_t* data)
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_command_dbus_name, dbusif->am_command_dbus_path,
-                dbusif->am_command_dbus_interface_name, "Disconnect");
+        dbus_request = new_command_message(dbusif, "Disconnect");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -886,8 +1957,7 @@ int router_dbusif_routing_register_domain(struct userdata *u, am_domain_register
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_routing_dbus_name, dbusif->am_routing_dbus_path,
-                dbusif->am_routing_dbus_interface_name, "registerDomain");
+        dbus_request = new_routing_message(dbusif, "registerDomain");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -977,8 +2047,7 @@ int router_dbusif_routing_deregister_domain(struct userdata *u, am_domain_unregi
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_routing_dbus_name, dbusif->am_routing_dbus_path,
-                dbusif->am_routing_dbus_interface_name, "deregisterDomain");
+        dbus_request = new_routing_message(dbusif, "deregisterDomain");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -1154,8 +2223,7 @@ int router_dbusif_routing_register_sink(struct userdata *u, am_sink_register_t*
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_routing_dbus_name, dbusif->am_routing_dbus_path,
-                dbusif->am_routing_dbus_interface_name, "registerSink");
+        dbus_request = new_routing_message(dbusif, "registerSink");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -1234,18 +2302,20 @@ int router_dbusif_routing_register_sink(struct userdata *u, am_sink_register_t*
         //listNotificationConfigurations
         success = success && router_dbusif_append_list_notification_configuration(&iter);
 #endif
+        if ( success == FALSE ) {
+            pa_log_error("DBUS argument append failed");
+            break;
+        }
         am_sink_register_t *sink_register_data = pa_xmemdup(data, sizeof(am_sink_register_t));
-        pa_log_error("sink Name=%s", sink_register_data->name);
-        dbus_reply = dbus_connection_send_with_reply_and_block(pa_dbus_connection_get(u->dbusif->conn), dbus_request,
-                DBUS_TIMEOUT_USE_DEFAULT, NULL);
-
-        if ( dbus_reply == NULL ) {
-            pa_log_error("send_message_with_reply failed");
+        pa_log_debug("sink Name=%s", sink_register_data->name);
+        success = send_shared_message_with_reply(u, dbus_request, router_dbusif_register_sink_reply_cb,
+                sink_register_data, sink_register_data->name);
+        if ( success == FALSE ) {
+            pa_log_error("error in send_message_with_reply for register sink");
+            MODULE_ROUTER_FREE(sink_register_data);
             break;
         }
-
-        router_dbusif_register_sink_reply_cb(u, dbus_reply, sink_register_data);
-
+        result = 0;
     } while ( 0 );
     if ( dbus_reply != NULL ) {
         dbus_message_unref(dbus_reply);
@@ -1275,8 +2345,7 @@ int router_dbusif_routing_deregister_sink(struct userdata *u, am_sink_unregister
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_routing_dbus_name, dbusif->am_routing_dbus_path,
-                dbusif->am_routing_dbus_interface_name, "deregisterSink");
+        dbus_request = new_routing_message(dbusif, "deregisterSink");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -1324,8 +2393,7 @@ int router_dbusif_routing_register_source(struct userdata *u, am_source_register
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_routing_dbus_name, dbusif->am_routing_dbus_path,
-                dbusif->am_routing_dbus_interface_name, "registerSource");
+        dbus_request = new_routing_message(dbusif, "registerSource");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -1369,16 +2437,20 @@ int router_dbusif_routing_register_source(struct userdata *u, am_source_register
         success = success && router_dbusif_append_list_notification_configuration(&outerStruct);
         success = success && dbus_message_iter_close_container(&iter, &outerStruct);
 
-        am_source_register_t *source_register_data = pa_xmemdup(data, sizeof(am_source_register_t));
-
-        dbus_reply = dbus_connection_send_with_reply_and_block(pa_dbus_connection_get(u->dbusif->conn), dbus_request,
-                DBUS_TIMEOUT_USE_DEFAULT, NULL);
+        if ( success == FALSE ) {
+            pa_log_error("DBUS argument append failed");
+            break;
+        }
 
-        if ( dbus_reply == NULL ) {
-            pa_log_error("send_message_with_reply failed");
+        am_source_register_t *source_register_data = pa_xmemdup(data, sizeof(am_source_register_t));
+        success = send_shared_message_with_reply(u, dbus_request, router_dbusif_register_source_reply_cb,
+                source_register_data, source_register_data->name);
+        if ( success == FALSE ) {
+            pa_log_error("error in send_message_with_reply for register source");
+            MODULE_ROUTER_FREE(source_register_data);
             break;
         }
-        router_dbusif_register_source_reply_cb(u, dbus_reply, source_register_data);
+        result = 0;
     } while ( 0 );
     if ( dbus_reply != NULL ) {
         dbus_message_unref(dbus_reply);
@@ -1397,7 +2469,7 @@ int router_dbusif_routing_register_source(struct userdata *u, am_source_register
  * @return int
  */
 int router_dbusif_routing_peek_sink(struct userdata *u, const char* sink_name) {
-    int result = 0;
+    int result = -1;
     router_dbusif* dbusif = u->dbusif;
     dbus_bool_t success = TRUE;
     DBusMessage* dbus_request = NULL;
@@ -1410,8 +2482,7 @@ int router_dbusif_routing_peek_sink(struct userdata *u, const char* sink_name) {
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_routing_dbus_name, dbusif->am_routing_dbus_path,
-                dbusif->am_routing_dbus_interface_name, "peekSink");
+        dbus_request = new_routing_message(dbusif, "peekSink");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -1423,15 +2494,20 @@ int router_dbusif_routing_peek_sink(struct userdata *u, const char* sink_name) {
          */
         char* sinkname = (char*) sink_name;
         success = success && dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &(sinkname));
-        dbus_reply = dbus_connection_send_with_reply_and_block(pa_dbus_connection_get(u->dbusif->conn), dbus_request,
-                DBUS_TIMEOUT_USE_DEFAULT, NULL);
-        am_sink_register_t sink_data;
-        strncpy(sink_data.name, sinkname, AM_MAX_NAME_LENGTH);
-        if ( dbus_reply == NULL ) {
-            pa_log_error("send_message_with_reply failed");
+        if ( success == FALSE ) {
+            pa_log_error("DBUS argument append failed");
+            break;
+        }
+        am_sink_register_t *sink_data = pa_xnew0(am_sink_register_t, 1);
+        pa_strlcpy(sink_data->name, sink_name, AM_MAX_NAME_LENGTH);
+        success = send_shared_message_with_reply(u, dbus_request, router_dbusif_peek_sink_reply_cb, sink_data,
+                sink_data->name);
+        if ( success == FALSE ) {
+            pa_log_error("error in send_message_with_reply for peek sink");
+            MODULE_ROUTER_FREE(sink_data);
             break;
         }
-        router_dbusif_peek_sink_reply_cb(u, dbus_reply, &sink_name);
+        result = 0;
     } while ( 0 );
     if ( dbus_reply != NULL ) {
         dbus_message_unref(dbus_reply);
@@ -1464,8 +2540,7 @@ int router_dbusif_routing_peek_source(struct userdata *u, const char* source_nam
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_routing_dbus_name, dbusif->am_routing_dbus_path,
-                dbusif->am_routing_dbus_interface_name, "peekSource");
+        dbus_request = new_routing_message(dbusif, "peekSource");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -1477,15 +2552,20 @@ int router_dbusif_routing_peek_source(struct userdata *u, const char* source_nam
          */
         char* sourcename = (char*) source_name;
         success = success && dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &(sourcename));
-        dbus_reply = dbus_connection_send_with_reply_and_block(pa_dbus_connection_get(u->dbusif->conn), dbus_request,
-                DBUS_TIMEOUT_USE_DEFAULT, NULL);
-        am_source_register_t source_register_data;
-        strncpy(source_register_data.name, source_name, AM_MAX_NAME_LENGTH);
-        if ( dbus_reply == NULL ) {
-            pa_log_error("send_message_with_reply failed");
+        if ( success == FALSE ) {
+            pa_log_error("DBUS argument append failed");
             break;
         }
-        router_dbusif_peek_source_reply_cb(u, dbus_reply, &source_register_data);
+        am_source_register_t *source_register_data = pa_xnew0(am_source_register_t, 1);
+        pa_strlcpy(source_register_data->name, source_name, AM_MAX_NAME_LENGTH);
+        success = send_shared_message_with_reply(u, dbus_request, router_dbusif_peek_source_reply_cb,
+                source_register_data, source_register_data->name);
+        if ( success == FALSE ) {
+            pa_log_error("error in send_message_with_reply for peek source");
+            MODULE_ROUTER_FREE(source_register_data);
+            break;
+        }
+        result = 0;
     } while ( 0 );
     if ( dbus_reply != NULL ) {
         dbus_message_unref(dbus_reply);
@@ -1518,8 +2598,7 @@ int router_dbusif_get_domain_of_source(struct userdata *u, const uint16_t source
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_routing_dbus_name, dbusif->am_routing_dbus_path,
-                dbusif->am_routing_dbus_interface_name, "getDomainOfSource");
+        dbus_request = new_routing_message(dbusif, "getDomainOfSource");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -1530,15 +2609,22 @@ int router_dbusif_get_domain_of_source(struct userdata *u, const uint16_t source
          * TODO construct the dbus message
          */
         success = success && dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT16, &(source_id));
-        dbus_reply = dbus_connection_send_with_reply_and_block(pa_dbus_connection_get(u->dbusif->conn), dbus_request,
-                DBUS_TIMEOUT_USE_DEFAULT, NULL);
-        am_domain_of_source_sink_t source_domain;
-        source_domain.id = source_id;
-        if ( dbus_reply == NULL ) {
-            pa_log_error("send_message_with_reply failed");
+        if ( success == FALSE ) {
+            pa_log_error("DBUS argument append failed");
+            break;
+        }
+        am_domain_of_source_sink_t *source_domain = pa_xnew0(am_domain_of_source_sink_t, 1);
+        source_domain->id = source_id;
+        char key[8];
+        snprintf(key, sizeof(key), "%u", source_id);
+        success = send_shared_message_with_reply(u, dbus_request, router_dbusif_get_domain_of_source_reply_cb,
+                source_domain, key);
+        if ( success == FALSE ) {
+            pa_log_error("error in send_message_with_reply for get domain of source");
+            MODULE_ROUTER_FREE(source_domain);
             break;
         }
-        router_dbusif_get_domain_of_source_reply_cb(u, dbus_reply, &source_domain);
+        result = 0;
     } while ( 0 );
     if ( dbus_reply != NULL ) {
         dbus_message_unref(dbus_reply);
@@ -1571,8 +2657,7 @@ int router_dbusif_get_domain_of_sink(struct userdata *u, const uint16_t sink_id)
         return result;
     }
     do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_routing_dbus_name, dbusif->am_routing_dbus_path,
-                dbusif->am_routing_dbus_interface_name, "getDomainOfSink");
+        dbus_request = new_routing_message(dbusif, "getDomainOfSink");
         if ( dbus_request == NULL ) {
             pa_log_error("DBUS message allocation failed");
             break;
@@ -1583,105 +2668,431 @@ int router_dbusif_get_domain_of_sink(struct userdata *u, const uint16_t sink_id)
          * TODO construct the dbus message
          */
         success = success && dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT16, &(sink_id));
-        dbus_reply = dbus_connection_send_with_reply_and_block(pa_dbus_connection_get(u->dbusif->conn), dbus_request,
-                DBUS_TIMEOUT_USE_DEFAULT, NULL);
-        am_domain_of_source_sink_t sink_domain;
-        sink_domain.id = sink_id;
-        if ( dbus_reply == NULL ) {
-            pa_log_error("send_message_with_reply failed");
+        if ( success == FALSE ) {
+            pa_log_error("DBUS argument append failed");
+            break;
+        }
+        am_domain_of_source_sink_t *sink_domain = pa_xnew0(am_domain_of_source_sink_t, 1);
+        sink_domain->id = sink_id;
+        char key[8];
+        snprintf(key, sizeof(key), "%u", sink_id);
+        success = send_shared_message_with_reply(u, dbus_request, router_dbusif_get_domain_of_sink_reply_cb,
+                sink_domain, key);
+        if ( success == FALSE ) {
+            pa_log_error("error in send_message_with_reply for get domain of sink");
+            MODULE_ROUTER_FREE(sink_domain);
+            break;
+        }
+        result = 0;
+    } while ( 0 );
+    if ( dbus_reply != NULL ) {
+        dbus_message_unref(dbus_reply);
+    }
+    if ( dbus_request != NULL ) {
+        dbus_message_unref(dbus_request);
+    }
+    ROUTER_FUNCTION_EXIT;
+    return result;
+
+}
+
+/**
+ * @brief This function sends the routing side deregister source request.
+ * @param u: The user data of the module.
+ *        data: The data structure for sink deregistration.
+ * @return int
+ */
+int router_dbusif_routing_deregister_source(struct userdata *u, am_source_unregister_t* data) {
+    int result = -1;
+    router_dbusif* dbusif = u->dbusif;
+    dbus_bool_t success = FALSE;
+    DBusMessage* dbus_request = NULL;
+    DBusMessage* dbus_reply = NULL;
+    ROUTER_FUNCTION_ENTRY;
+    if ( dbusif == NULL || dbusif->am_routing_dbus_name == NULL || dbusif->am_routing_dbus_path == NULL
+            || dbusif->am_routing_dbus_interface_name == NULL ) {
+        return result;
+    }
+    do {
+        dbus_request = new_routing_message(dbusif, "deregisterSource");
+        if ( dbus_request == NULL ) {
+            pa_log_error("DBUS message allocation failed");
+            break;
+        }
+        success = dbus_message_append_args(dbus_request, DBUS_TYPE_UINT16, &data->source_id, DBUS_TYPE_INVALID);
+        if ( success == FALSE ) {
+            pa_log_error("DBUS argument append failed");
+            break;
+        }
+        am_source_unregister_t *source_unregister_data = pa_xmemdup(data, sizeof(am_source_unregister_t));
+        success = send_message_with_reply(u, dbus_request, router_dbusif_deregister_source_reply_cb,
+                source_unregister_data);
+        if ( success == FALSE ) {
+            pa_log_error("error in send_message_with_reply for de-register source");
             break;
         }
-        router_dbusif_get_domain_of_sink_reply_cb(u, dbus_reply, &sink_domain);
     } while ( 0 );
     if ( dbus_reply != NULL ) {
         dbus_message_unref(dbus_reply);
     }
-    if ( dbus_request != NULL ) {
-        dbus_message_unref(dbus_request);
+    if ( dbus_request != NULL ) {
+        dbus_message_unref(dbus_request);
+    }
+    ROUTER_FUNCTION_EXIT;
+    return result;
+}
+
+/**
+ * @brief This function frees the router interface.
+ * @param u: The user data of the module.
+ * @return int
+ */
+static void free_routerif(struct userdata *u) {
+    DBusConnection *dbusconn;
+    pending_dbus_calls_t *p;
+    pending_chunk_t *chunk;
+    char **rule;
+    pending_waiter_t *w;
+    router_dbusif* routerif = u->dbusif;
+    ROUTER_FUNCTION_ENTRY;
+    if ( routerif ) {
+
+        if ( routerif->conn ) {
+            dbusconn = pa_dbus_connection_get(routerif->conn);
+            while ( (p = pa_hashmap_steal_first(routerif->calls)) != NULL ) {
+                PA_LLIST_REMOVE(pending_dbus_calls_t, routerif->wheel[p->slot], p);
+                dbus_pending_call_set_notify(p->call, NULL, NULL, NULL);
+                dbus_pending_call_cancel(p->call);
+                dbus_pending_call_unref(p->call);
+                while ( (w = p->waiters) != NULL ) {
+                    PA_LLIST_REMOVE(pending_waiter_t, p->waiters, w);
+                    MODULE_ROUTER_FREE(w->data);
+                    pa_xfree(w);
+                }
+                if ( p->key ) {
+                    pa_hashmap_remove(routerif->inflight, p->key);
+                    pa_xfree(p->key);
+                }
+                MODULE_ROUTER_FREE(p->data);
+            }
+
+            /* the audiomanager still expects the acks of the requests already handled */
+            flush_acks(u, true);
+            ring_close(u);
+            peer_close(u);
+
+            if ( u ) {
+                dbus_connection_remove_filter(dbusconn, router_dbusif_signal_filter, u);
+            }
+
+            for ( rule = routerif->am_watch_rules; rule && *rule; rule++ ) {
+                dbus_bus_remove_match(dbusconn, *rule, NULL);
+            }
+            dbus_bus_remove_match(dbusconn, routerif->am_owner_rule, NULL);
+
+            pa_dbus_connection_unref(routerif->conn);
+        }
+        if ( routerif->wheel_event ) {
+            u->core->mainloop->time_free(routerif->wheel_event);
+            routerif->wheel_event = NULL;
+        }
+        while ( (chunk = routerif->chunks) != NULL ) {
+            routerif->chunks = chunk->next;
+            pa_xfree(chunk);
+        }
+        if ( routerif->calls ) {
+            pa_hashmap_free(routerif->calls);
+            routerif->calls = NULL;
+        }
+        if ( routerif->deadlines ) {
+            pa_hashmap_free(routerif->deadlines);
+            routerif->deadlines = NULL;
+        }
+        if ( routerif->ack_event ) {
+            u->core->mainloop->defer_free(routerif->ack_event);
+            routerif->ack_event = NULL;
+        }
+        if ( routerif->flow_event ) {
+            u->core->mainloop->time_free(routerif->flow_event);
+            routerif->flow_event = NULL;
+        }
+        if ( routerif->acks ) {
+            pa_queue_free(routerif->acks, (pa_free_cb_t) queued_ack_free);
+            routerif->acks = NULL;
+        }
+    }
+    ROUTER_FUNCTION_EXIT;
+}
+
+/**
+ * @brief This function frees a queued ack.
+ * @param ack: The queued ack.
+ * @return void
+ */
+static void queued_ack_free(queued_ack_t *ack) {
+    if ( ack->msg ) {
+        dbus_message_unref(ack->msg);
+    }
+    pa_xfree(ack);
+}
+
+/**
+ * @brief This function publishes the flow control counters in the property list of the module, they show up in
+ * 'pactl list modules'.
+ * @param u: The user data of the module.
+ *        outgoing: The depth of the outgoing queue in bytes.
+ * @return void
+ */
+static void update_stats(struct userdata *u, long outgoing) {
+    router_dbusif *routerif = u->dbusif;
+    pa_proplist *p;
+
+    if ( (u->module == NULL) || ((p = u->module->proplist) == NULL) ) {
+        return;
+    }
+    routerif->stats_time = pa_rtclock_now();
+    pa_proplist_setf(p, "router.dbus.outgoing_bytes", "%ld", outgoing);
+    pa_proplist_setf(p, "router.dbus.throttled", "%s", routerif->throttled ? "yes" : "no");
+    pa_proplist_setf(p, "router.dbus.acks_queued", "%u", routerif->acks_queued);
+    pa_proplist_setf(p, "router.dbus.requests_refused", "%u", routerif->requests_refused);
+    pa_proplist_setf(p, "router.dbus.calls_pending", "%u", pa_hashmap_size(routerif->calls));
+    pa_proplist_setf(p, "router.dbus.calls_expired", "%u", routerif->expired);
+    pa_proplist_setf(p, "router.dbus.signals_dispatched", "%u", routerif->signals_dispatched);
+    pa_proplist_setf(p, "router.dbus.signals_dropped", "%u", routerif->signals_dropped);
+}
+
+/**
+ * @brief This function checks the depth of the outgoing queue against the watermarks. The acks are held back once
+ * the queue is above the high watermark, until it drains below the low one.
+ * @param u: The user data of the module.
+ *        conn: The connection to check.
+ * @return bool true while the acks are held back.
+ */
+static bool flow_throttled(struct userdata *u, DBusConnection *conn) {
+    router_dbusif *routerif = u->dbusif;
+    long outgoing = dbus_connection_get_outgoing_size(conn);
+    bool throttled = routerif->throttled;
+
+    if ( throttled && (outgoing <= FLOW_LOW_WATERMARK) ) {
+        pa_log_info("%s: outgoing queue drained to %ld bytes, resuming the acks", __FILE__, outgoing);
+        throttled = false;
+    } else if ( !throttled && (outgoing >= FLOW_HIGH_WATERMARK) ) {
+        pa_log_warn("%s: outgoing queue at %ld bytes, holding the acks back", __FILE__, outgoing);
+        throttled = true;
+    }
+    if ( (throttled != routerif->throttled) || (pa_rtclock_now() - routerif->stats_time >= STATS_INTERVAL_USEC) ) {
+        routerif->throttled = throttled;
+        update_stats(u, outgoing);
+    }
+    return throttled;
+}
+
+/**
+ * @brief The retry timer of the flow control, it tries to flush the acks held back.
+ * @param m: The main loop api.
+ *        e: The time event.
+ *        t: The time at which the event fired.
+ *        userdata: The user data of the module.
+ * @return void
+ */
+static void flow_retry_cb(pa_mainloop_api *m, pa_time_event *e, const struct timeval *t, void *userdata) {
+    struct userdata *u = (struct userdata *) userdata;
+
+    pa_assert(u);
+    flush_acks(u, false);
+}
+
+/**
+ * @brief This function puts all the queued acks on the bus, in the order in which they were queued. While the
+ * outgoing queue is above the watermark the acks stay queued and the flush is retried later.
+ * @param u: The user data of the module.
+ *        force: true to send regardless of the depth of the outgoing queue.
+ * @return void
+ */
+static void flush_acks(struct userdata *u, bool force) {
+    router_dbusif *routerif = u->dbusif;
+    DBusConnection *conn;
+    queued_ack_t *ack;
+    uint32_t count = 0;
+
+    if ( (routerif->acks == NULL) || pa_queue_isempty(routerif->acks) ) {
+        return;
+    }
+    conn = connection_for(routerif, routerif->am_routing_dbus_interface_name);
+    if ( !force && flow_throttled(u, conn) ) {
+        if ( routerif->flow_event == NULL ) {
+            routerif->flow_event = pa_core_rttime_new(u->core, pa_rtclock_now() + FLOW_RETRY_USEC, flow_retry_cb, u);
+        } else {
+            pa_core_rttime_restart(u->core, routerif->flow_event, pa_rtclock_now() + FLOW_RETRY_USEC);
+        }
+        return;
+    }
+    while ( (ack = pa_queue_pop(routerif->acks)) != NULL ) {
+        if ( dbus_connection_send(conn, ack->msg, NULL) == FALSE ) {
+            pa_log_error("%s: failed to send the D-Bus message '%s'", __FILE__, dbus_message_get_member(ack->msg));
+        }
+        queued_ack_free(ack);
+        routerif->acks_queued--;
+        count++;
+    }
+    pa_log_debug("flushed %u acks", count);
+}
+
+/**
+ * @brief The deferred event which flushes the acks queued during the last main loop iteration.
+ * @param m: The main loop api.
+ *        e: The deferred event.
+ *        userdata: The user data of the module.
+ * @return void
+ */
+static void ack_event_cb(pa_mainloop_api *m, pa_defer_event *e, void *userdata) {
+    struct userdata *u = (struct userdata *) userdata;
+
+    pa_assert(u);
+    m->defer_enable(e, 0);
+    flush_acks(u, false);
+}
+
+/**
+ * @brief This function reports the completion of the registration batch once it is closed and the last of its
+ * replies has landed.
+ * @param u: The user data of the module.
+ * @return void
+ */
+static void batch_check_done(struct userdata *u) {
+    router_dbusif *routerif = u->dbusif;
+    uint32_t size;
+
+    if ( routerif->batch_open || !pa_hashmap_isempty(routerif->batch) || (routerif->batch_start == 0) ) {
+        return;
+    }
+    size = routerif->batch_size;
+    pa_log_info("registration batch of %u requests completed in %llu ms", size,
+            (unsigned long long) ((pa_rtclock_now() - routerif->batch_start) / PA_USEC_PER_MSEC));
+    routerif->batch_size = 0;
+    routerif->batch_start = 0;
+    if ( routerif->cb_routing_register_batch_done ) {
+        routerif->cb_routing_register_batch_done(u, size);
     }
-    ROUTER_FUNCTION_EXIT;
-    return result;
-
 }
 
 /**
- * @brief This function sends the routing side deregister source request.
+ * @brief This function opens a registration batch, every request sent until the batch is closed is put on the
+ * bus right away and its reply is correlated by serial.
  * @param u: The user data of the module.
- *        data: The data structure for sink deregistration.
- * @return int
+ * @return void
  */
-int router_dbusif_routing_deregister_source(struct userdata *u, am_source_unregister_t* data) {
-    int result = -1;
-    router_dbusif* dbusif = u->dbusif;
-    dbus_bool_t success = FALSE;
-    DBusMessage* dbus_request = NULL;
-    DBusMessage* dbus_reply = NULL;
+void router_dbusif_registration_batch_begin(struct userdata *u) {
+    router_dbusif *routerif = u->dbusif;
     ROUTER_FUNCTION_ENTRY;
-    if ( dbusif == NULL || dbusif->am_routing_dbus_name == NULL || dbusif->am_routing_dbus_path == NULL
-            || dbusif->am_routing_dbus_interface_name == NULL ) {
-        return result;
-    }
-    do {
-        dbus_request = dbus_message_new_method_call(dbusif->am_routing_dbus_name, dbusif->am_routing_dbus_path,
-                dbusif->am_routing_dbus_interface_name, "deregisterSource");
-        if ( dbus_request == NULL ) {
-            pa_log_error("DBUS message allocation failed");
-            break;
-        }
-        success = dbus_message_append_args(dbus_request, DBUS_TYPE_UINT16, &data->source_id, DBUS_TYPE_INVALID);
-        if ( success == FALSE ) {
-            pa_log_error("DBUS argument append failed");
-            break;
-        }
-        am_source_unregister_t *source_unregister_data = pa_xmemdup(data, sizeof(am_source_unregister_t));
-        success = send_message_with_reply(u, dbus_request, router_dbusif_deregister_source_reply_cb,
-                source_unregister_data);
-        if ( success == FALSE ) {
-            pa_log_error("error in send_message_with_reply for de-register source");
-            break;
-        }
-    } while ( 0 );
-    if ( dbus_reply != NULL ) {
-        dbus_message_unref(dbus_reply);
+    if ( routerif == NULL ) {
+        return;
     }
-    if ( dbus_request != NULL ) {
-        dbus_message_unref(dbus_request);
+    routerif->batch_open = true;
+    if ( routerif->batch_start == 0 ) {
+        routerif->batch_start = pa_rtclock_now();
     }
     ROUTER_FUNCTION_EXIT;
-    return result;
 }
 
 /**
- * @brief This function frees the router interface.
+ * @brief This function closes the registration batch, the completion callback is called once all the replies
+ * of the batch have been received.
  * @param u: The user data of the module.
- * @return int
+ * @return void
  */
-static void free_routerif(struct userdata *u) {
-    DBusConnection *dbusconn;
-    pending_dbus_calls_t *p, *n;
-    router_dbusif* routerif = u->dbusif;
+void router_dbusif_registration_batch_end(struct userdata *u) {
+    router_dbusif *routerif = u->dbusif;
     ROUTER_FUNCTION_ENTRY;
-    if ( routerif ) {
+    if ( routerif == NULL ) {
+        return;
+    }
+    routerif->batch_open = false;
+    pa_log_debug("registration batch of %u requests in flight", routerif->batch_size);
+    batch_check_done(u);
+    ROUTER_FUNCTION_EXIT;
+}
 
-        if ( routerif->conn ) {
-            dbusconn = pa_dbus_connection_get(routerif->conn);
-            PA_LLIST_FOREACH_SAFE(p, n, routerif->pending_call_list)
-            {
-                PA_LLIST_REMOVE(pending_dbus_calls_t, routerif->pending_call_list, p);
-                dbus_pending_call_set_notify(p->call, NULL, NULL, NULL);
-                dbus_pending_call_unref(p->call);
-            }
+/**
+ * @brief This function takes an entry for a new pending call from the slab, a new chunk is allocated only when all
+ * the entries are in use.
+ * @param routerif: The router interface structure.
+ * @return pending_dbus_calls_t*: The cleared pending call entry.
+ */
+static pending_dbus_calls_t* pending_call_new(router_dbusif *routerif) {
+    pending_chunk_t *chunk;
+    pending_dbus_calls_t *pdata;
+    unsigned i;
+
+    if ( routerif->free_calls == NULL ) {
+        chunk = pa_xnew0(pending_chunk_t, 1);
+        chunk->next = routerif->chunks;
+        routerif->chunks = chunk;
+        for ( i = 0; i < PENDING_CHUNK_SIZE; i++ ) {
+            PA_LLIST_PREPEND(pending_dbus_calls_t, routerif->free_calls, &chunk->calls[i]);
+        }
+    }
+    pdata = routerif->free_calls;
+    PA_LLIST_REMOVE(pending_dbus_calls_t, routerif->free_calls, pdata);
+    memset(pdata, 0, sizeof(*pdata));
+    return pdata;
+}
 
-            if ( u ) {
-                dbus_connection_remove_filter(dbusconn, router_dbusif_method_handler, u);
-            }
+/**
+ * @brief This function gives the entry of a finished pending call back to the slab.
+ * @param routerif: The router interface structure.
+ *        pdata: The pending call entry.
+ * @return void
+ */
+static void pending_call_release(router_dbusif *routerif, pending_dbus_calls_t *pdata) {
+    PA_LLIST_PREPEND(pending_dbus_calls_t, routerif->free_calls, pdata);
+}
+
+/**
+ * @brief This function completes a pending call, it calls the callback for the request and for every request which
+ * joined it, then gives the entry back to the slab.
+ * @param u: The user data of the module.
+ *        pdata: The pending call.
+ *        reply: The reply, or NULL if the call failed.
+ * @return void
+ */
+static void complete_call(struct userdata *u, pending_dbus_calls_t *pdata, DBusMessage *reply) {
+    router_dbusif *routerif = u->dbusif;
+    pending_waiter_t *waiter;
 
-            dbus_bus_remove_match(dbusconn, routerif->am_watch_rule, NULL);
+    pa_hashmap_remove(routerif->calls, pdata);
+    PA_LLIST_REMOVE(pending_dbus_calls_t, routerif->wheel[pdata->slot], pdata);
+    dbus_pending_call_unref(pdata->call);
+    /* requests made from the callbacks below must not join the call which is being completed */
+    if ( pdata->key ) {
+        pa_hashmap_remove(routerif->inflight, pdata->key);
+    }
 
-            pa_dbus_connection_unref(routerif->conn);
+    if ( reply == NULL ) {
+        pa_log("%s: pending call failed: invalid argument",
+        __FILE__);
+        MODULE_ROUTER_FREE(pdata->data);
+    } else {
+        if ( dbus_message_get_reply_serial(reply) != pdata->serial ) {
+            pa_log_warn("%s: reply serial %u does not match request serial %u", __FILE__,
+                    dbus_message_get_reply_serial(reply), pdata->serial);
+        }
+        pdata->cb(u, reply, pdata->data);
+    }
+    while ( (waiter = pdata->waiters) != NULL ) {
+        PA_LLIST_REMOVE(pending_waiter_t, pdata->waiters, waiter);
+        if ( reply ) {
+            pdata->cb(u, reply, waiter->data);
+        } else {
+            MODULE_ROUTER_FREE(waiter->data);
         }
+        pa_xfree(waiter);
     }
-    ROUTER_FUNCTION_EXIT;
+    if ( pa_hashmap_remove(routerif->batch, pdata) != NULL ) {
+        batch_check_done(u);
+    }
+    MODULE_ROUTER_FREE(pdata->key);
+    pending_call_release(routerif, pdata);
 }
 
 /**
@@ -1695,40 +3106,122 @@ static void free_routerif(struct userdata *u) {
 static void reply_cb(DBusPendingCall *pend, void *data) {
     pending_dbus_calls_t *pdata = (pending_dbus_calls_t*) data;
     struct userdata *u;
-    router_dbusif *routerif;
     DBusMessage *reply;
     ROUTER_FUNCTION_ENTRY;
     pa_assert(pdata);
     pa_assert(pdata->call == pend);
     pa_assert_se((u = pdata->u));
+
+    reply = dbus_pending_call_steal_reply(pend);
+    complete_call(u, pdata, reply);
+    if ( reply ) {
+        dbus_message_unref(reply);
+    }
+    ROUTER_FUNCTION_EXIT;
+}
+
+/**
+ * @brief This function gives up on a pending call whose deadline has passed, the callbacks get a NoReply error
+ * as they would from a timed out call.
+ * @param u: The user data of the module.
+ *        pdata: The pending call.
+ * @return void
+ */
+static void expire_call(struct userdata *u, pending_dbus_calls_t *pdata) {
+    DBusMessage *reply;
+    const char *descr = "no reply from the audiomanager";
+
+    pa_log_warn("%s: request serial %u timed out", __FILE__, pdata->serial);
+    u->dbusif->expired++;
+    dbus_pending_call_set_notify(pdata->call, NULL, NULL, NULL);
+    dbus_pending_call_cancel(pdata->call);
+
+    reply = dbus_message_new(DBUS_MESSAGE_TYPE_ERROR);
+    if ( reply ) {
+        dbus_message_set_error_name(reply, DBUS_ERROR_NO_REPLY);
+        dbus_message_set_reply_serial(reply, pdata->serial);
+        dbus_message_append_args(reply, DBUS_TYPE_STRING, &descr, DBUS_TYPE_INVALID);
+    }
+    complete_call(u, pdata, reply);
+    if ( reply ) {
+        dbus_message_unref(reply);
+    }
+}
+
+/**
+ * @brief The timer wheel tick, it expires the calls of the slot it moves to and stops once no call is pending.
+ * @param m: The main loop api.
+ *        e: The time event.
+ *        t: The time at which the event fired.
+ *        userdata: The user data of the module.
+ * @return void
+ */
+static void wheel_tick_cb(pa_mainloop_api *m, pa_time_event *e, const struct timeval *t, void *userdata) {
+    struct userdata *u = (struct userdata *) userdata;
+    router_dbusif *routerif;
+    pending_dbus_calls_t *p, *n;
+
+    pa_assert(u);
     pa_assert_se((routerif = u->dbusif));
 
-    PA_LLIST_REMOVE(pending_dbus_calls_t, routerif->pending_call_list, pdata);
+    routerif->wheel_pos = (routerif->wheel_pos + 1) % WHEEL_SLOTS;
+    PA_LLIST_FOREACH_SAFE(p, n, routerif->wheel[routerif->wheel_pos])
+    {
+        if ( p->rounds > 0 ) {
+            p->rounds--;
+        } else {
+            expire_call(u, p);
+        }
+    }
+    if ( pa_hashmap_isempty(routerif->calls) ) {
+        routerif->wheel_running = false;
+    } else {
+        pa_core_rttime_restart(u->core, e, pa_rtclock_now() + WHEEL_TICK_USEC);
+    }
+}
 
-    if ( (reply = dbus_pending_call_steal_reply(pend)) == NULL ) {
-        pa_log("%s: pending call failed: invalid argument",
-        __FILE__);
+/**
+ * @brief This function puts a pending call on the timer wheel, the deadline is rounded up to the wheel tick.
+ * @param u: The user data of the module.
+ *        pdata: The pending call.
+ *        timeout: The deadline in ms.
+ * @return void
+ */
+static void wheel_arm(struct userdata *u, pending_dbus_calls_t *pdata, uint32_t timeout) {
+    router_dbusif *routerif = u->dbusif;
+    unsigned ticks;
+
+    ticks = (unsigned) PA_MAX((timeout * PA_USEC_PER_MSEC + WHEEL_TICK_USEC - 1) / WHEEL_TICK_USEC, 1);
+    pdata->slot = (routerif->wheel_pos + ticks) % WHEEL_SLOTS;
+    pdata->rounds = (ticks - 1) / WHEEL_SLOTS;
+    PA_LLIST_PREPEND(pending_dbus_calls_t, routerif->wheel[pdata->slot], pdata);
+
+    if ( routerif->wheel_running ) {
+        return;
+    }
+    if ( routerif->wheel_event == NULL ) {
+        routerif->wheel_event = pa_core_rttime_new(u->core, pa_rtclock_now() + WHEEL_TICK_USEC, wheel_tick_cb, u);
     } else {
-        pdata->cb(u, reply, pdata->data);
-        dbus_message_unref(reply);
+        pa_core_rttime_restart(u->core, routerif->wheel_event, pa_rtclock_now() + WHEEL_TICK_USEC);
     }
-    pa_xfree((void *) pdata);
-    ROUTER_FUNCTION_EXIT;
+    routerif->wheel_running = true;
 }
 
 /**
- * @brief This function sends the syncronous request.
+ * @brief This function sends the asynchronous request and tracks it in the pending call table until its reply
+ * arrives or its deadline passes.
  * @param u: The user data of the module.
  *        msg: The dbus message.
  *        cb: The callback function to be called when reply is received
  *        data: The user data to be passed in callback.
- * @return int
+ * @return pending_dbus_calls_t*: The pending call, NULL on failure.
  */
-static bool send_message_with_reply(struct userdata *u, DBusMessage *msg, pending_cb_t cb, void *data) {
+static pending_dbus_calls_t* send_pending_call(struct userdata *u, DBusMessage *msg, pending_cb_t cb, void *data) {
     router_dbusif *routerif;
     pending_dbus_calls_t* pdata = NULL;
     const char *method;
-    DBusPendingCall *pend;
+    uint32_t timeout;
+    DBusPendingCall *pend = NULL;
     DBusConnection *dbusconn;
     ROUTER_FUNCTION_ENTRY;
 
@@ -1737,34 +3230,107 @@ static bool send_message_with_reply(struct userdata *u, DBusMessage *msg, pendin
     pa_assert(cb);
     pa_assert_se((routerif = u->dbusif));
 
-    pdata = pa_xnew0(pending_dbus_calls_t, 1);
+    pdata = pending_call_new(routerif);
     pdata->u = u;
     pdata->cb = cb;
     pdata->data = data;
+    method = dbus_message_get_member(msg);
 
-    dbusconn = pa_dbus_connection_get(routerif->conn);
+    dbusconn = connection_for(routerif, dbus_message_get_interface(msg));
+    if ( dbus_connection_get_outgoing_size(dbusconn) >= FLOW_HARD_LIMIT ) {
+        pa_log_error("%s: outgoing queue full, refusing %s", __FILE__, method);
+        routerif->requests_refused++;
+        goto failed;
+    }
 
-    PA_LLIST_PREPEND(pending_dbus_calls_t, routerif->pending_call_list, pdata);
-    if ( !dbus_connection_send_with_reply(dbusconn, msg, &pend, -1) ) {
+    /* the deadline is kept by the timer wheel, one time event for all the calls instead of one per call */
+    if ( !dbus_connection_send_with_reply(dbusconn, msg, &pend, DBUS_TIMEOUT_INFINITE) || (pend == NULL) ) {
         pa_log("%s: Failed to %s", __FILE__, method);
         goto failed;
     }
 
     pdata->call = pend;
+    pdata->serial = dbus_message_get_serial(msg);
 
     if ( !dbus_pending_call_set_notify(pend, reply_cb, pdata, NULL) ) {
         pa_log("%s: Can't set notification for %s", __FILE__, method);
+        dbus_pending_call_cancel(pend);
+        dbus_pending_call_unref(pend);
         goto failed;
     }
 
+    if ( (timeout = PA_PTR_TO_UINT32(pa_hashmap_get(routerif->deadlines, method))) == 0 ) {
+        timeout = routerif->reply_timeout;
+    }
+    pa_hashmap_put(routerif->calls, pdata, pdata);
+    wheel_arm(u, pdata, timeout);
+
+    if ( routerif->batch_open ) {
+        pa_hashmap_put(routerif->batch, pdata, pdata);
+        routerif->batch_size++;
+    }
+
     ROUTER_FUNCTION_EXIT;
-    return true;
+    return pdata;
 
     failed: if ( pdata ) {
-        PA_LLIST_REMOVE(pending_dbus_calls_t, routerif->pending_call_list, pdata);
-        pa_xfree((void *) pdata);
+        pending_call_release(routerif, pdata);
     }
-    return false;
+    return NULL;
+}
+
+/**
+ * @brief This function sends the asynchronous request.
+ * @param u: The user data of the module.
+ *        msg: The dbus message.
+ *        cb: The callback function to be called when reply is received
+ *        data: The user data to be passed in callback.
+ * @return bool true on success.
+ */
+static bool send_message_with_reply(struct userdata *u, DBusMessage *msg, pending_cb_t cb, void *data) {
+    return (send_pending_call(u, msg, cb, data) != NULL);
+}
+
+/**
+ * @brief This function sends the asynchronous request unless an identical one is already in flight, in that case
+ * the request joins it and its callback is called with the reply of that call.
+ * @param u: The user data of the module.
+ *        msg: The dbus message.
+ *        cb: The callback function to be called when reply is received
+ *        data: The user data to be passed in callback.
+ *        key: The key which identifies the request together with the method name.
+ * @return bool true on success.
+ */
+static bool send_shared_message_with_reply(struct userdata *u, DBusMessage *msg, pending_cb_t cb, void *data,
+        const char *key) {
+    router_dbusif *routerif;
+    pending_dbus_calls_t *pdata;
+    pending_waiter_t *waiter;
+    char *flight_key;
+
+    pa_assert(u);
+    pa_assert(key);
+    pa_assert_se((routerif = u->dbusif));
+
+    flight_key = pa_sprintf_malloc("%s/%s", dbus_message_get_member(msg), key);
+    pdata = pa_hashmap_get(routerif->inflight, flight_key);
+    if ( (pdata != NULL) && (pdata->cb == cb) ) {
+        pa_log_debug("%s: joining the %s request in flight", __FILE__, flight_key);
+        waiter = pa_xnew0(pending_waiter_t, 1);
+        waiter->data = data;
+        PA_LLIST_PREPEND(pending_waiter_t, pdata->waiters, waiter);
+        pa_xfree(flight_key);
+        return true;
+    }
+
+    pdata = send_pending_call(u, msg, cb, data);
+    if ( pdata == NULL ) {
+        pa_xfree(flight_key);
+        return false;
+    }
+    pdata->key = flight_key;
+    pa_hashmap_put(routerif->inflight, pdata->key, pdata);
+    return true;
 }
 
 /**
@@ -1930,7 +3496,7 @@ static void router_dbusif_deregister_domain_reply_cb(struct userdata *u, DBusMes
 static void router_dbusif_register_sink_reply_cb(struct userdata *u, DBusMessage *reply, void *data) {
     const char *error_descr;
     dbus_uint16_t sink_id;
-    dbus_uint16_t status;
+    dbus_uint16_t status = E_NOT_POSSIBLE;
     dbus_bool_t success = FALSE;
     ROUTER_FUNCTION_ENTRY;
     if ( dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR ) {
@@ -1948,11 +3514,11 @@ static void router_dbusif_register_sink_reply_cb(struct userdata *u, DBusMessage
         } else {
             pa_log_info("audiomanger replied to sink registration: sinkID: %u, status %u", sink_id, status);
             ((am_sink_register_t*) data)->sink_id = sink_id;
-            if ( u->dbusif->cb_routing_register_sink_reply ) {
-                u->dbusif->cb_routing_register_sink_reply(u, status, data);
-            }
         }
     }
+    if ( u->dbusif->cb_routing_register_sink_reply ) {
+        u->dbusif->cb_routing_register_sink_reply(u, status, data);
+    }
     MODULE_ROUTER_FREE(data);
     ROUTER_FUNCTION_EXIT;
 }
@@ -2002,7 +3568,7 @@ static void router_dbusif_deregister_sink_reply_cb(struct userdata *u, DBusMessa
 static void router_dbusif_register_source_reply_cb(struct userdata *u, DBusMessage *reply, void *data) {
     const char *error_descr;
     dbus_uint16_t source_id;
-    dbus_uint16_t status;
+    dbus_uint16_t status = E_NOT_POSSIBLE;
     dbus_bool_t success = FALSE;
     ROUTER_FUNCTION_ENTRY;
     if ( dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR ) {
@@ -2020,11 +3586,11 @@ static void router_dbusif_register_source_reply_cb(struct userdata *u, DBusMessa
         } else {
             pa_log_info("audiomanger replied to source registration: sourceID: %u, status %u", source_id, status);
             ((am_source_register_t*) data)->source_id = source_id;
-            if ( u->dbusif->cb_routing_register_source_reply ) {
-                u->dbusif->cb_routing_register_source_reply(u, status, data);
-            }
         }
     }
+    if ( u->dbusif->cb_routing_register_source_reply ) {
+        u->dbusif->cb_routing_register_source_reply(u, status, data);
+    }
     MODULE_ROUTER_FREE(data);
     ROUTER_FUNCTION_EXIT;
 }
@@ -2039,7 +3605,7 @@ static void router_dbusif_register_source_reply_cb(struct userdata *u, DBusMessa
 static void router_dbusif_peek_source_reply_cb(struct userdata *u, DBusMessage *reply, void *data) {
     const char *error_descr;
     dbus_uint16_t source_id;
-    dbus_uint16_t status;
+    dbus_uint16_t status = E_NOT_POSSIBLE;
     dbus_bool_t success = FALSE;
     ROUTER_FUNCTION_ENTRY;
     if ( dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR ) {
@@ -2057,13 +3623,13 @@ static void router_dbusif_peek_source_reply_cb(struct userdata *u, DBusMessage *
         } else {
             pa_log_info("audiomanger replied to source peek: sourceID: %u, status %u", source_id, status);
             ((am_source_register_t*) data)->source_id = source_id;
-            if ( u->dbusif->cb_routing_peek_source_reply ) {
-                u->dbusif->cb_routing_peek_source_reply(u, status, data);
-            }
         }
     }
-    //Not allocated dynamically
-    //MODULE_ROUTER_FREE(data);
+    /* failed calls are reported with E_NOT_POSSIBLE so that the pending admission is finished */
+    if ( u->dbusif->cb_routing_peek_source_reply ) {
+        u->dbusif->cb_routing_peek_source_reply(u, status, data);
+    }
+    MODULE_ROUTER_FREE(data);
     ROUTER_FUNCTION_EXIT;
 
 }
@@ -2079,7 +3645,7 @@ static void router_dbusif_peek_source_reply_cb(struct userdata *u, DBusMessage *
 static void router_dbusif_peek_sink_reply_cb(struct userdata *u, DBusMessage *reply, void *data) {
     const char *error_descr;
     dbus_uint16_t sink_id;
-    dbus_uint16_t status;
+    dbus_uint16_t status = E_NOT_POSSIBLE;
     dbus_bool_t success = FALSE;
     ROUTER_FUNCTION_ENTRY;
     if ( dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR ) {
@@ -2093,17 +3659,16 @@ static void router_dbusif_peek_sink_reply_cb(struct userdata *u, DBusMessage *re
         success = dbus_message_get_args(reply, NULL, DBUS_TYPE_UINT16, &sink_id, DBUS_TYPE_UINT16, &status,
                 DBUS_TYPE_INVALID);
         if ( success == FALSE ) {
-            pa_log_error("parsing of out parameters failed for sink registration");
+            pa_log_error("parsing of out parameters failed for sink peek");
         } else {
-            pa_log_info("audiomanger replied to source registration: sinkID: %u, status %u", sink_id, status);
+            pa_log_info("audiomanger replied to sink peek: sinkID: %u, status %u", sink_id, status);
             ((am_sink_register_t*) data)->sink_id = sink_id;
-            if ( u->dbusif->cb_routing_register_sink_reply ) {
-                u->dbusif->cb_routing_register_sink_reply(u, status, data);
-            }
         }
     }
-    //Not allocated dynamically
-    //MODULE_ROUTER_FREE(data);
+    if ( u->dbusif->cb_routing_peek_sink_reply ) {
+        u->dbusif->cb_routing_peek_sink_reply(u, status, data);
+    }
+    MODULE_ROUTER_FREE(data);
     ROUTER_FUNCTION_EXIT;
 
 }
@@ -2118,7 +3683,7 @@ static void router_dbusif_peek_sink_reply_cb(struct userdata *u, DBusMessage *re
 static void router_dbusif_get_domain_of_source_reply_cb(struct userdata * u, DBusMessage *reply, void * data) {
     const char *error_descr;
     dbus_uint16_t domain_id;
-    dbus_uint16_t status;
+    dbus_uint16_t status = E_NOT_POSSIBLE;
     dbus_bool_t success = FALSE;
     ROUTER_FUNCTION_ENTRY;
     if ( dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR ) {
@@ -2136,13 +3701,12 @@ static void router_dbusif_get_domain_of_source_reply_cb(struct userdata * u, DBu
         } else {
             pa_log_info("audiomanger replied to getDomainOfSource peek: domain_id: %u, status %u", domain_id, status);
             ((am_domain_of_source_sink_t*) data)->domain_id = domain_id;
-            if ( u->dbusif->cb_routing_get_domain_of_source_reply ) {
-                u->dbusif->cb_routing_get_domain_of_source_reply(u, status, data);
-            }
         }
     }
-    //Not allocated dynamically
-    //MODULE_ROUTER_FREE(data);
+    if ( u->dbusif->cb_routing_get_domain_of_source_reply ) {
+        u->dbusif->cb_routing_get_domain_of_source_reply(u, status, data);
+    }
+    MODULE_ROUTER_FREE(data);
     ROUTER_FUNCTION_EXIT;
 
 }
@@ -2157,7 +3721,7 @@ static void router_dbusif_get_domain_of_source_reply_cb(struct userdata * u, DBu
 static void router_dbusif_get_domain_of_sink_reply_cb(struct userdata *u, DBusMessage *reply, void *data) {
     const char *error_descr;
     dbus_uint16_t domain_id;
-    dbus_uint16_t status;
+    dbus_uint16_t status = E_NOT_POSSIBLE;
     dbus_bool_t success = FALSE;
     ROUTER_FUNCTION_ENTRY;
     if ( dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR ) {
@@ -2175,13 +3739,33 @@ static void router_dbusif_get_domain_of_sink_reply_cb(struct userdata *u, DBusMe
         } else {
             pa_log_info("audiomanger replied to getDomainOfSink : domain_id: %u, status %u", domain_id, status);
             ((am_domain_of_source_sink_t*) data)->domain_id = domain_id;
-            if ( u->dbusif->cb_routing_get_domain_of_sink_reply ) {
-                u->dbusif->cb_routing_get_domain_of_sink_reply(u, status, data);
-            }
         }
     }
-    //Not allocated dynamically
-    //MODULE_ROUTER_FREE(data);
+    if ( u->dbusif->cb_routing_get_domain_of_sink_reply ) {
+        u->dbusif->cb_routing_get_domain_of_sink_reply(u, status, data);
+    }
+    MODULE_ROUTER_FREE(data);
+    ROUTER_FUNCTION_EXIT;
+}
+
+/**
+ * @brief The callback function for the bus get name owner reply, it learns the unique name of an audiomanager which
+ * was already running when the module was loaded.
+ * @param u: The user data of the module.
+ *        reply: The dbus reply message.
+ *        data: Unused.
+ * @return void
+ */
+static void router_dbusif_get_name_owner_reply_cb(struct userdata *u, DBusMessage *reply, void *data) {
+    const char *owner;
+    ROUTER_FUNCTION_ENTRY;
+    /* an error only means the audiomanager is not on the bus yet, NameOwnerChanged reports it once it is */
+    if ( (dbus_message_get_type(reply) != DBUS_MESSAGE_TYPE_ERROR)
+            && (dbus_message_get_args(reply, NULL, DBUS_TYPE_STRING, &owner, DBUS_TYPE_INVALID) == TRUE)
+            && (u->dbusif->am_owner == NULL) ) {
+        pa_log_debug("%s: owner of '%s' is '%s'", __FILE__, u->dbusif->am_routing_dbus_name, owner);
+        u->dbusif->am_owner = pa_xstrdup(owner);
+    }
     ROUTER_FUNCTION_EXIT;
 }
 
@@ -2221,7 +3805,24 @@ static void router_dbusif_deregister_source_reply_cb(struct userdata *u, DBusMes
 }
 
 /**
- * @brief The internal function to send the ack for async requests
+ * @brief The internal function to put an ack message on the ack queue, the queue takes the ownership of the message.
+ * @param u: The user data of the module.
+ *        msg: The ack message.
+ * @return void
+ */
+static void queue_ack(struct userdata *u, DBusMessage *msg) {
+    queued_ack_t *ack;
+
+    /* acks are sent from the deferred event, so a burst of requests is written in one go */
+    ack = pa_xnew0(queued_ack_t, 1);
+    ack->msg = msg;
+    pa_queue_push(u->dbusif->acks, ack);
+    u->dbusif->acks_queued++;
+    u->core->mainloop->defer_enable(u->dbusif->ack_event, 1);
+}
+
+/**
+ * @brief The internal function to queue the ack for async requests, the queue is flushed from a deferred event
  * @param u: The user data of the module.
  *        method_name: The name of the async request.
  *        handle: the request identifier.
@@ -2232,7 +3833,6 @@ static void router_dbusif_deregister_source_reply_cb(struct userdata *u, DBusMes
  */
 static bool send_ack(struct userdata *u, char *method_name, uint16_t handle, uint16_t *param1, int16_t *param2,
         uint16_t error) {
-    DBusConnection *conn = NULL;
     DBusMessage *msg = NULL;
     bool status = true;
     dbus_bool_t success = FALSE;
@@ -2243,11 +3843,9 @@ static bool send_ack(struct userdata *u, char *method_name, uint16_t handle, uin
     pa_assert(u->dbusif->am_routing_dbus_name);
     pa_assert(u->dbusif->am_routing_dbus_path);
     pa_assert(u->dbusif->am_routing_dbus_interface_name);
-    conn = pa_dbus_connection_get(u->dbusif->conn);
-    pa_assert(conn);
+    pa_assert(u->dbusif->acks);
 
-    msg = dbus_message_new_method_call(u->dbusif->am_routing_dbus_name, u->dbusif->am_routing_dbus_path,
-            u->dbusif->am_routing_dbus_interface_name, method_name);
+    msg = new_routing_message(u->dbusif, method_name);
     do {
         if ( !msg ) {
             pa_log_error("%s: failed to create the D-Bus message for '%s'", __FILE__, method_name);
@@ -2271,12 +3869,8 @@ static bool send_ack(struct userdata *u, char *method_name, uint16_t handle, uin
             break;
         }
 
-        success = dbus_connection_send(conn, msg, NULL);
-        if ( success == FALSE ) {
-            pa_log_error("%s: failed to send the D-Bus message '%s'", __FILE__, method_name);
-            status = false;
-            break;
-        }
+        queue_ack(u, msg);
+        msg = NULL;
     } while ( 0 );
 
     if ( msg )
@@ -2324,6 +3918,10 @@ void router_dbusif_ack_disconnect(struct userdata *u, uint16_t handle, uint16_t
  */
 void router_dbus_ack_set_sink_volume(struct userdata *u, uint16_t handle, uint16_t volume, uint16_t error) {
     ROUTER_FUNCTION_ENTRY;
+    if ( ring_ack(u, RING_CMD_SET_SINK_VOLUME, handle, (int16_t) volume, error) ) {
+        ROUTER_FUNCTION_EXIT;
+        return;
+    }
 #ifdef GENIVI_DBUS_PLUGIN
     send_ack(u, "ackSetSinkVolume", handle, NULL, &volume, error);
 #else
@@ -2342,6 +3940,10 @@ void router_dbus_ack_set_sink_volume(struct userdata *u, uint16_t handle, uint16
  */
 void router_dbus_ack_set_source_volume(struct userdata *u, uint16_t handle, uint16_t volume, uint16_t error) {
     ROUTER_FUNCTION_ENTRY;
+    if ( ring_ack(u, RING_CMD_SET_SOURCE_VOLUME, handle, (int16_t) volume, error) ) {
+        ROUTER_FUNCTION_EXIT;
+        return;
+    }
 #ifdef GENIVI_DBUS_PLUGIN
     send_ack(u, "ackSetSourceVolume", handle, NULL, &volume, error);
 #else
@@ -2362,3 +3964,59 @@ void router_dbus_ack_set_source_state(struct userdata *u, uint16_t handle, uint1
     send_ack(u, "ackSetSourceState", handle, NULL, NULL, error);
     ROUTER_FUNCTION_EXIT;
 }
+
+/**
+ * @brief The ack for async set volumes, one message carries the result of every element of the request. The
+ * signature q a(qqn) q (handle, then type, id and volume per element, then the error) is specific to this module.
+ * @param u: The user data of the module.
+ *        handle: The identifier for the request.
+ *        volumes: The volumes which were set
+ *        count: The number of volumes
+ *        error: The error status of the async request
+ * @return void
+ */
+void router_dbus_ack_set_volumes(struct userdata *u, uint16_t handle, const am_volume_t *volumes, uint32_t count,
+        uint16_t error) {
+    DBusMessage *msg = NULL;
+    DBusMessageIter iter;
+    DBusMessageIter array;
+    DBusMessageIter element;
+    dbus_bool_t success;
+    uint32_t i;
+    ROUTER_FUNCTION_ENTRY;
+    pa_assert(u);
+    pa_assert(u->dbusif);
+    pa_assert(volumes || (count == 0));
+
+    msg = new_routing_message(u->dbusif, "ackSetVolumes");
+    do {
+        if ( !msg ) {
+            pa_log_error("%s: failed to create the D-Bus message for 'ackSetVolumes'", __FILE__);
+            break;
+        }
+
+        dbus_message_iter_init_append(msg, &iter);
+        success = dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT16, &handle);
+        success = success && dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(qqn)", &array);
+        for ( i = 0; success && (i < count); i++ ) {
+            success = dbus_message_iter_open_container(&array, DBUS_TYPE_STRUCT, NULL, &element)
+                    && dbus_message_iter_append_basic(&element, DBUS_TYPE_UINT16, &volumes[i].type)
+                    && dbus_message_iter_append_basic(&element, DBUS_TYPE_UINT16, &volumes[i].id)
+                    && dbus_message_iter_append_basic(&element, DBUS_TYPE_INT16, &volumes[i].volume)
+                    && dbus_message_iter_close_container(&array, &element);
+        }
+        success = success && dbus_message_iter_close_container(&iter, &array);
+        success = success && dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT16, &error);
+        if ( success == FALSE ) {
+            pa_log_error("%s: failed to append args of DBus message 'ackSetVolumes'", __FILE__);
+            break;
+        }
+
+        queue_ack(u, msg);
+        msg = NULL;
+    } while ( 0 );
+
+    if ( msg )
+        dbus_message_unref(msg);
+    ROUTER_FUNCTION_EXIT;
+}
@@ -22,6 +22,10 @@
 
 #define E_OK 0
 #define E_NOT_POSSIBLE 7
+#define E_NON_EXISTENT 8
+
+/* default deadline in ms for the replies of the audiomanager */
+#define AM_REPLY_TIMEOUT_DEFAULT 5000
 
 typedef struct {
     uint16_t handle;
@@ -29,6 +33,7 @@ typedef struct {
     uint16_t sink_id;
     uint16_t connection_id;
     int32_t connection_format;
+    uint32_t loopback_module_index;
 } am_connect_t;
 
 typedef struct {
@@ -111,6 +116,21 @@ typedef struct {
 
 } am_domain_of_source_sink_t;
 
+/* element types of a batched volume request */
+#define VT_SINK    1
+#define VT_SOURCE  2
+
+/* upper bound of the elements of one batched volume request */
+#define AM_MAX_VOLUMES 256
+
+typedef struct {
+    uint16_t type;
+    uint16_t id;
+    int16_t volume;
+    int16_t ramp_type;
+    uint16_t ramp_time;
+} am_volume_t;
+
 typedef void (*cb_new_main_connection_t)(struct userdata*, am_main_connection_t*);
 typedef void (*cb_removed_main_connection_t)(struct userdata*, uint16_t);
 typedef void (*cb_main_connection_state_changed_t)(struct userdata*, uint16_t, int32_t);
@@ -125,6 +145,9 @@ typedef void (*cb_routing_deregister_source_reply_t)(struct userdata*, int32_t s
 typedef void (*cb_routing_peek_source_reply_t)(struct userdata*, int32_t status, void*);
 typedef void (*cb_routing_peek_sink_reply_t)(struct userdata*, int32_t status, void*);
 typedef void (*cb_routing_get_domain_of_source_reply_t)(struct userdata*, int32_t status, void*);
+typedef void (*cb_routing_register_batch_done_t)(struct userdata*, uint32_t count);
+typedef void (*cb_element_changed_t)(struct userdata*, uint16_t id, const char *name);
+typedef void (*cb_am_owner_changed_t)(struct userdata*, bool available);
 typedef void (*cb_routing_get_domain_of_sink_reply_t)(struct userdata*, int32_t status, void*);
 
 typedef void (*cb_routing_deregister_source_reply_t)(struct userdata*, int32_t status, void*);
@@ -132,6 +155,7 @@ typedef uint16_t (*cb_routing_async_connect_t)(struct userdata*, uint16_t, uint1
 typedef uint16_t (*cb_routing_async_disconnect_t)(struct userdata*, uint16_t, uint16_t);
 typedef uint16_t (*cb_routing_async_set_volume_t)(struct userdata*, uint16_t, uint16_t, int16_t, int16_t, uint16_t);
 typedef uint16_t (*cb_routing_async_set_source_state_t)(struct userdata*, uint16_t, uint16_t, int32_t);
+typedef uint16_t (*cb_routing_async_set_volumes_t)(struct userdata*, uint16_t, const am_volume_t*, uint32_t);
 
 typedef struct {
 
@@ -146,7 +170,9 @@ typedef struct {
     char* am_routing_dbus_name;
     char* am_routing_dbus_interface_name;
     char* am_routing_dbus_path;
-    char* am_watch_rule;
+    /* D-Bus address of the audiomanager for a peer to peer connection, NULL to use the system bus only */
+    char* am_address;
+    uint32_t reply_timeout;
     cb_new_main_connection_t cb_new_main_connection;
     cb_removed_main_connection_t cb_removed_main_connection;
     cb_main_connection_state_changed_t cb_main_connection_state_changed;
@@ -165,10 +191,17 @@ typedef struct {
     cb_routing_async_set_volume_t cb_routing_async_set_sink_volume;
     cb_routing_async_set_volume_t cb_routing_async_set_source_volume;
     cb_routing_async_set_source_state_t cb_routing_async_set_source_state;
+    cb_routing_async_set_volumes_t cb_routing_async_set_volumes;
     cb_routing_peek_source_reply_t cb_routing_peek_source_reply;
     cb_routing_peek_sink_reply_t cb_routing_peek_sink_reply;
     cb_routing_get_domain_of_source_reply_t cb_routing_get_domain_of_source_reply;
     cb_routing_get_domain_of_sink_reply_t cb_routing_get_domain_of_sink_reply;
+    cb_routing_register_batch_done_t cb_routing_register_batch_done;
+    cb_element_changed_t cb_new_sink;
+    cb_element_changed_t cb_new_source;
+    cb_element_changed_t cb_removed_sink;
+    cb_element_changed_t cb_removed_source;
+    cb_am_owner_changed_t cb_am_owner_changed;
 
 } router_init_data_t;
 
@@ -189,6 +222,8 @@ int router_dbusif_get_domain_of_source(struct userdata *u, const uint16_t source
 int router_dbusif_get_domain_of_sink(struct userdata *u, const uint16_t sink_id);
 
 int router_dbusif_routing_register_source(struct userdata *u, am_source_register_t* data);
+void router_dbusif_registration_batch_begin(struct userdata *u);
+void router_dbusif_registration_batch_end(struct userdata *u);
 int router_dbusif_routing_deregister_source(struct userdata *u, am_source_unregister_t* data);
 
 int router_dbusif_ack_async_connect(struct userdata *u, int handle, uint16_t connectionID, int error);
@@ -204,4 +239,7 @@ void router_dbus_ack_set_source_volume(struct userdata *u, uint16_t handle, uint
 
 void router_dbus_ack_set_source_state(struct userdata *u, uint16_t handle, uint16_t error);
 
+void router_dbus_ack_set_volumes(struct userdata *u, uint16_t handle, const am_volume_t *volumes, uint32_t count,
+        uint16_t error);
+
 #endif /* __ROUTER_DBUSIFACE_H__ */
@@ -0,0 +1,465 @@
+/******************************************************************************
+ * @file: router-map.c
+ *
+ * The file contains the implementation of the functions which maintain the
+ * source/sink maps of the PulseAudio router module and their lookup indices.
+ *
+ *
+ * @component: PulseAudio router module
+ *
+ * @author: Toshiaki Isogai <tisogai@jp.adit-jv.com>
+ *          Kapildev Patel  <kpatel@jp.adit-jv.com>
+ *
+ * @copyright (c) 2016 Advanced Driver Information Technology.
+ * This code is developed by Advanced Driver Information Technology.
+ * Copyright of Advanced Driver Information Technology, Bosch, and DENSO.
+ * All rights reserved.
+ *
+ *****************************************************************************/
+
+#include <pulsecore/pulsecore-config.h>
+#include <stdint.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/idxset.h>
+#include <pulsecore/hashmap.h>
+#include "router-userdata.h"
+#include "router-strings.h"
+#include "router-map.h"
+
+/*
+ * The indices store the map index incremented by one, so that a NULL value
+ * returned by pa_hashmap_get() always means "not found".
+ */
+#define INDEX_TO_PTR(index) ((void*) (intptr_t) ((index) + 1))
+#define PTR_TO_INDEX(ptr) ((int16_t) ((intptr_t) (ptr) - 1))
+#define STR_TO_KEY(handle) ((void*) (uintptr_t) (handle))
+
+/* resizes one of the per field arrays of the map and clears the new elements */
+#define GROW_ARRAY(array, type, old_size, new_size) \
+    do { \
+        (array) = pa_xrenew(type, (array), (new_size)); \
+        memset(&(array)[(old_size)], 0, ((new_size) - (old_size)) * sizeof(type)); \
+    } while ( 0 )
+
+/**
+ * @brief This function initializes an empty source/sink map.
+ * @param map: The pointer to the map
+ *        strings: The string table holding the names and descriptions of the entries.
+ * @return void
+ */
+void router_map_init(router_map *map, router_strings *strings) {
+    pa_assert(map);
+    pa_assert(strings);
+    map->strings = strings;
+    map->id = NULL;
+    map->domain_id = NULL;
+    map->builtin = NULL;
+    map->source_state = NULL;
+    map->data = NULL;
+    map->entry = NULL;
+    map->size = 0;
+    map->free_slots = NULL;
+    map->free_count = 0;
+    memset(map->id_index, 0, sizeof(map->id_index));
+    map->name_index = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+    map->description_index = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+    map->data_index = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+}
+
+/**
+ * @brief This function releases the resources held by the map.
+ * @param map: The pointer to the map
+ * @return void
+ */
+void router_map_done(router_map *map) {
+    pa_assert(map);
+    if ( map->name_index ) {
+        pa_hashmap_free(map->name_index);
+        map->name_index = NULL;
+    }
+    if ( map->description_index ) {
+        pa_hashmap_free(map->description_index);
+        map->description_index = NULL;
+    }
+    if ( map->data_index ) {
+        pa_hashmap_free(map->data_index);
+        map->data_index = NULL;
+    }
+    for ( int page = 0 ; page < AM_ID_INDEX_PAGES ; page++ ) {
+        MODULE_ROUTER_FREE(map->id_index[page]);
+        map->id_index[page] = NULL;
+    }
+    MODULE_ROUTER_FREE(map->id);
+    map->id = NULL;
+    MODULE_ROUTER_FREE(map->domain_id);
+    map->domain_id = NULL;
+    MODULE_ROUTER_FREE(map->builtin);
+    map->builtin = NULL;
+    MODULE_ROUTER_FREE(map->source_state);
+    map->source_state = NULL;
+    MODULE_ROUTER_FREE(map->data);
+    map->data = NULL;
+    MODULE_ROUTER_FREE(map->entry);
+    map->entry = NULL;
+    MODULE_ROUTER_FREE(map->free_slots);
+    map->free_slots = NULL;
+    map->size = 0;
+    map->free_count = 0;
+}
+
+/**
+ * @brief This function doubles the number of entries of the map and puts the new slots on the free list.
+ * @param map: The pointer to the map
+ * @return bool: false if the map already has the maximum size.
+ */
+static bool router_map_grow(router_map *map) {
+    int32_t new_size;
+    if ( map->size >= AM_MAP_MAX_SIZE ) {
+        return false;
+    }
+    new_size = (map->size == 0) ? AM_MAP_INITIAL_SIZE : (2 * map->size);
+    if ( new_size > AM_MAP_MAX_SIZE ) {
+        new_size = AM_MAP_MAX_SIZE;
+    }
+    GROW_ARRAY(map->id, uint16_t, map->size, new_size);
+    GROW_ARRAY(map->domain_id, uint16_t, map->size, new_size);
+    GROW_ARRAY(map->builtin, bool, map->size, new_size);
+    GROW_ARRAY(map->source_state, uint16_t, map->size, new_size);
+    GROW_ARRAY(map->data, void*, map->size, new_size);
+    GROW_ARRAY(map->entry, name_id_map, map->size, new_size);
+    map->free_slots = pa_xrenew(int16_t, map->free_slots, new_size);
+    /* push in reverse order, so that the lowest slot is handed out first */
+    for ( int32_t index = new_size - 1 ; index >= map->size ; index-- ) {
+        map->free_slots[map->free_count++] = (int16_t) index;
+    }
+    pa_log_debug("router_map_grow size %d -> %d", map->size, new_size);
+    map->size = (int16_t) new_size;
+    return true;
+}
+
+/**
+ * @brief This function returns a free entry of the map, the map grows if there is no free entry left.
+ * Pointers into the entries are not stable across this call.
+ * @param map: The pointer to the map
+ * @return int16_t: The index of the free entry, -1 if the map reached AM_MAP_MAX_SIZE.
+ */
+int16_t router_map_alloc(router_map *map) {
+    int16_t index;
+    pa_assert(map);
+    if ( (map->free_count == 0) && (router_map_grow(map) == false) ) {
+        pa_log_error("router_map_alloc: map is full");
+        return -1;
+    }
+    index = map->free_slots[--map->free_count];
+    pa_assert(map->entry[index].in_use == false);
+    map->entry[index].in_use = true;
+    return index;
+}
+
+/**
+ * @brief This function clears an entry of the map and puts it back on the free list.
+ * @param map: The pointer to the map
+ *        index: The index of the map entry.
+ * @return void
+ */
+void router_map_release(router_map *map, int16_t index) {
+    pa_assert(map);
+    pa_assert(index >= 0 && index < map->size);
+    pa_assert(map->entry[index].in_use);
+
+    router_map_set_name(map, index, "");
+    router_map_set_description(map, index, "");
+    router_map_set_id(map, index, 0);
+    router_map_set_data(map, index, NULL);
+    map->domain_id[index] = 0;
+    map->builtin[index] = false;
+    map->source_state[index] = 0;
+    memset(&map->entry[index], 0, sizeof(name_id_map));
+    map->free_slots[map->free_count++] = index;
+}
+
+/**
+ * @brief This function returns the name or the description handle of a map entry.
+ * @param map: The pointer to the map
+ *        index: The index of the map entry.
+ *        description: true for the description, false for the name.
+ * @return router_str: The handle.
+ */
+static router_str entry_string(const router_map *map, int16_t index, bool description) {
+    return description ? map->entry[index].description : map->entry[index].name;
+}
+
+/**
+ * @brief This function returns the links of a map entry to the other entries sharing its name or description.
+ * @param map: The pointer to the map
+ *        index: The index of the map entry.
+ *        description: true for the description, false for the name.
+ * @return router_str_link*: The links.
+ */
+static router_str_link* entry_link(router_map *map, int16_t index, bool description) {
+    return description ? &map->entry[index].description_link : &map->entry[index].name_link;
+}
+
+/**
+ * @brief This function moves an entry of the name or description index from one string to another.
+ * Strings owned by another entry keep pointing to the first owner, the entry is linked behind it. When the
+ * owner drops a string which is shared with other entries, the index moves to the next linked entry, so
+ * neither case needs to look at the other entries of the map.
+ * @param map: The pointer to the map
+ *        index: The index of the map entry.
+ *        description: true to update the description index, false for the name index.
+ *        new_handle: The string the entry is indexed with afterwards, 0 if none.
+ * @return void
+ */
+static void reindex_string(router_map *map, int16_t index, bool description, router_str new_handle) {
+    pa_hashmap *index_map = description ? map->description_index : map->name_index;
+    router_str old_handle = entry_string(map, index, description);
+    router_str_link *link = entry_link(map, index, description);
+    router_str_link *owner;
+    void *value;
+
+    if ( old_handle != 0 ) {
+        if ( link->prev != 0 ) {
+            entry_link(map, link->prev - 1, description)->next = link->next;
+        } else {
+            pa_hashmap_remove(index_map, STR_TO_KEY(old_handle));
+            if ( link->next != 0 ) {
+                pa_hashmap_put(index_map, STR_TO_KEY(old_handle), INDEX_TO_PTR(link->next - 1));
+            }
+        }
+        if ( link->next != 0 ) {
+            entry_link(map, link->next - 1, description)->prev = link->prev;
+        }
+        link->prev = 0;
+        link->next = 0;
+    }
+    if ( new_handle != 0 ) {
+        if ( (value = pa_hashmap_get(index_map, STR_TO_KEY(new_handle))) == NULL ) {
+            pa_hashmap_put(index_map, STR_TO_KEY(new_handle), INDEX_TO_PTR(index));
+        } else {
+            owner = entry_link(map, PTR_TO_INDEX(value), description);
+            link->prev = (int16_t) (PTR_TO_INDEX(value) + 1);
+            link->next = owner->next;
+            if ( owner->next != 0 ) {
+                entry_link(map, owner->next - 1, description)->prev = (int16_t) (index + 1);
+            }
+            owner->next = (int16_t) (index + 1);
+        }
+    }
+}
+
+/**
+ * @brief This function returns the entry indexed with a string.
+ * @param strings: The string table of the map.
+ *        index_map: The name or description index of the map.
+ *        string: The string to be searched.
+ * @return int16_t: The index of the map entry, -1 if not found.
+ */
+static int16_t lookup_string(const router_strings *strings, pa_hashmap *index_map, const char *string) {
+    void *value;
+    router_str handle = router_strings_find(strings, string);
+    if ( handle == 0 ) {
+        return -1;
+    }
+    value = pa_hashmap_get(index_map, STR_TO_KEY(handle));
+    return (value != NULL) ? PTR_TO_INDEX(value) : -1;
+}
+
+/**
+ * @brief This function sets the audiomanager name of a map entry and keeps the name index in sync.
+ * An empty name is never indexed. If the name is already owned by another entry, the index keeps
+ * pointing to that entry.
+ * @param map: The pointer to the map
+ *        index: The index of the map entry.
+ *        name: The new name of the entry.
+ * @return void
+ */
+void router_map_set_name(router_map *map, int16_t index, const char *name) {
+    router_str handle;
+    router_str old_handle;
+    pa_assert(map);
+    pa_assert(name);
+    pa_assert(index >= 0 && index < map->size);
+
+    /* the entry holds one reference on its name, the old one is given back once it is out of the index */
+    handle = router_strings_intern(map->strings, name);
+    old_handle = map->entry[index].name;
+    if ( old_handle != handle ) {
+        reindex_string(map, index, false, handle);
+        map->entry[index].name = handle;
+    }
+    router_strings_unref(map->strings, old_handle);
+}
+
+/**
+ * @brief This function returns the map index which matches the name.
+ * @param map: The pointer to the map
+ *        name: The audiomanager name.
+ * @return int16_t: The index of the map entry, -1 if not found.
+ */
+int16_t router_map_index_from_name(const router_map *map, const char *name) {
+    pa_assert(map);
+    return lookup_string(map->strings, map->name_index, name);
+}
+
+/**
+ * @brief This function returns the audiomanager name of a map entry.
+ * @param map: The pointer to the map
+ *        index: The index of the map entry.
+ * @return const char*: The name, an empty string if the entry has no name.
+ */
+const char* router_map_get_name(const router_map *map, int16_t index) {
+    pa_assert(map);
+    pa_assert(index >= 0 && index < map->size);
+    return router_strings_get(map->strings, map->entry[index].name);
+}
+
+/**
+ * @brief This function sets the pulseaudio description of a map entry and keeps the description
+ * index in sync. If the description is already owned by another entry, the index keeps pointing to
+ * that entry.
+ * @param map: The pointer to the map
+ *        index: The index of the map entry.
+ *        description: The new description of the entry.
+ * @return void
+ */
+void router_map_set_description(router_map *map, int16_t index, const char *description) {
+    router_str handle;
+    router_str old_handle;
+    pa_assert(map);
+    pa_assert(index >= 0 && index < map->size);
+
+    /* the entry holds one reference on its description, the old one is given back once it is out of the index */
+    handle = router_strings_intern(map->strings, description);
+    old_handle = map->entry[index].description;
+    if ( old_handle != handle ) {
+        reindex_string(map, index, true, handle);
+        map->entry[index].description = handle;
+    }
+    router_strings_unref(map->strings, old_handle);
+}
+
+/**
+ * @brief This function returns the pulseaudio description of a map entry.
+ * @param map: The pointer to the map
+ *        index: The index of the map entry.
+ * @return const char*: The description, an empty string if the entry has no description.
+ */
+const char* router_map_get_description(const router_map *map, int16_t index) {
+    pa_assert(map);
+    pa_assert(index >= 0 && index < map->size);
+    return router_strings_get(map->strings, map->entry[index].description);
+}
+
+/**
+ * @brief This function returns the map index which matches the description.
+ * @param map: The pointer to the map
+ *        description: The pulseaudio description.
+ * @return int16_t: The index of the map entry, -1 if not found.
+ */
+int16_t router_map_index_from_description(const router_map *map, const char *description) {
+    pa_assert(map);
+    return lookup_string(map->strings, map->description_index, description);
+}
+
+/**
+ * @brief This function returns the slot of the id index which holds the given id.
+ * @param map: The pointer to the map
+ *        id: The audiomanager id.
+ *        create: If true the page holding the id is allocated when missing.
+ * @return uint32_t*: The pointer to the slot, NULL if the page does not exist.
+ */
+static uint32_t* id_index_slot(const router_map *map, uint16_t id, bool create) {
+    uint32_t **page = (uint32_t**) &map->id_index[id >> AM_ID_INDEX_PAGE_SHIFT];
+    if ( *page == NULL ) {
+        if ( !create ) {
+            return NULL;
+        }
+        *page = pa_xnew0(uint32_t, AM_ID_INDEX_PAGE_SIZE);
+    }
+    return &(*page)[id & (AM_ID_INDEX_PAGE_SIZE - 1)];
+}
+
+/**
+ * @brief This function sets the audiomanager id of a map entry and keeps the id index in sync.
+ * The id 0 is never handed out by the audiomanager, it marks an entry which is not yet registered
+ * and is therefore not indexed. If another entry already uses the id, the index moves to this entry.
+ * @param map: The pointer to the map
+ *        index: The index of the map entry.
+ *        id: The new audiomanager id of the entry.
+ * @return void
+ */
+void router_map_set_id(router_map *map, int16_t index, uint16_t id) {
+    uint32_t *slot;
+    pa_assert(map);
+    pa_assert(index >= 0 && index < map->size);
+
+    if ( map->id[index] != 0 ) {
+        slot = id_index_slot(map, map->id[index], false);
+        if ( (slot != NULL) && (*slot == (uint32_t) (index + 1)) ) {
+            *slot = 0;
+        }
+    }
+
+    map->id[index] = id;
+    if ( id != 0 ) {
+        slot = id_index_slot(map, id, true);
+        *slot = (uint32_t) (index + 1);
+    }
+}
+
+/**
+ * @brief This function returns the index of the map entry from the id.
+ * @param map: The pointer to the map
+ *        id: The audiomanager id.
+ * @return int16_t: The index of the map entry, -1 if not found.
+ */
+int16_t router_map_index_from_id(const router_map *map, uint16_t id) {
+    uint32_t *slot;
+    pa_assert(map);
+    if ( id == 0 ) {
+        return -1;
+    }
+    slot = id_index_slot(map, id, false);
+    return ((slot != NULL) && (*slot != 0)) ? (int16_t) (*slot - 1) : -1;
+}
+
+/**
+ * @brief This function sets the pulseaudio object of a map entry and keeps the data index in sync.
+ * The object is a pa_sink_input/pa_source_output for application sources/sinks and a pa_sink/pa_source
+ * for builtin ones. If another entry already uses the object, the index moves to this entry.
+ * @param map: The pointer to the map
+ *        index: The index of the map entry.
+ *        data: The pulseaudio object, NULL to unbind the entry.
+ * @return void
+ */
+void router_map_set_data(router_map *map, int16_t index, void *data) {
+    pa_assert(map);
+    pa_assert(index >= 0 && index < map->size);
+
+    if ( (map->data[index] != NULL) && (pa_hashmap_get(map->data_index, map->data[index]) == INDEX_TO_PTR(index)) ) {
+        pa_hashmap_remove(map->data_index, map->data[index]);
+    }
+
+    map->data[index] = data;
+    if ( data != NULL ) {
+        pa_hashmap_remove(map->data_index, data);
+        pa_hashmap_put(map->data_index, data, INDEX_TO_PTR(index));
+    }
+}
+
+/**
+ * @brief This function returns the index of the map entry bound to a pulseaudio object.
+ * @param map: The pointer to the map
+ *        data: The pulseaudio object.
+ * @return int16_t: The index of the map entry, -1 if not found.
+ */
+int16_t router_map_index_from_data(const router_map *map, const void *data) {
+    void *value;
+    pa_assert(map);
+    if ( data == NULL ) {
+        return -1;
+    }
+    value = pa_hashmap_get(map->data_index, data);
+    return (value != NULL) ? PTR_TO_INDEX(value) : -1;
+}
@@ -0,0 +1,43 @@
+/******************************************************************************
+ * @file: router-map.h
+ *
+ * The file contains the declarations of the functions which maintain the
+ * source/sink maps of the PulseAudio router module and their lookup indices.
+ *
+ *
+ * @component: PulseAudio router module
+ *
+ * @author: Toshiaki Isogai <tisogai@jp.adit-jv.com>
+ *          Kapildev Patel  <kpatel@jp.adit-jv.com>
+ *
+ * @copyright (c) 2016 Advanced Driver Information Technology.
+ * This code is developed by Advanced Driver Information Technology.
+ * Copyright of Advanced Driver Information Technology, Bosch, and DENSO.
+ * All rights reserved.
+ *
+ *****************************************************************************/
+
+#ifndef __ROUTER_MAP_H__
+#define __ROUTER_MAP_H__
+
+void router_map_init(router_map *map, router_strings *strings);
+void router_map_done(router_map *map);
+
+int16_t router_map_alloc(router_map *map);
+void router_map_release(router_map *map, int16_t index);
+
+void router_map_set_name(router_map *map, int16_t index, const char *name);
+int16_t router_map_index_from_name(const router_map *map, const char *name);
+const char* router_map_get_name(const router_map *map, int16_t index);
+
+void router_map_set_description(router_map *map, int16_t index, const char *description);
+const char* router_map_get_description(const router_map *map, int16_t index);
+int16_t router_map_index_from_description(const router_map *map, const char *description);
+
+void router_map_set_id(router_map *map, int16_t index, uint16_t id);
+int16_t router_map_index_from_id(const router_map *map, uint16_t id);
+
+void router_map_set_data(router_map *map, int16_t index, void *data);
+int16_t router_map_index_from_data(const router_map *map, const void *data);
+
+#endif /* __ROUTER_MAP_H__ */
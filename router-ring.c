@@ -0,0 +1,247 @@
+/******************************************************************************
+ * @file: router-ring.c
+ *
+ * The file contains the implementation of the shared memory command ring of
+ * the router module. The ring lives in a sealed memfd shared with the
+ * audiomanager and holds two single producer single consumer rings: the
+ * commands written by the audiomanager and the acks written by the module.
+ * Each side rings an eventfd doorbell after writing, so neither side polls.
+ *
+ * @component: PulseAudio router module
+ *
+ * @author: Toshiaki Isogai <tisogai@jp.adit-jv.com>
+ *          Kapildev Patel  <kpatel@jp.adit-jv.com>
+ *
+ * @copyright (c) 2016 Advanced Driver Information Technology.
+ * This code is developed by Advanced Driver Information Technology.
+ * Copyright of Advanced Driver Information Technology, Bosch, and DENSO.
+ * All rights reserved.
+ *
+ *****************************************************************************/
+
+/* memfd_create and the file sealing flags */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pulsecore/pulsecore-config.h>
+#include <stdint.h>
+#include <pulsecore/core-util.h>
+#include "router-userdata.h"
+#include "router-ring.h"
+
+#ifdef HAVE_MEMFD
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <pulsecore/atomic.h>
+
+#define RING_CACHELINE 64
+
+/* every index sits on its own cache line, the two sides never write the same line */
+typedef struct {
+    pa_atomic_t value;
+    uint8_t pad[RING_CACHELINE - sizeof(pa_atomic_t)];
+} ring_index;
+
+/*
+ * The head of the shared memory. The indices are free running, the slot of
+ * an index is index & (slots - 1).
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t cmd_offset;
+    uint32_t ack_offset;
+    uint8_t pad[RING_CACHELINE - 5 * sizeof(uint32_t)];
+    /* written by the module */
+    ring_index cmd_head;
+    /* written by the audiomanager */
+    ring_index cmd_tail;
+    /* written by the audiomanager */
+    ring_index ack_head;
+    /* written by the module */
+    ring_index ack_tail;
+} ring_header;
+
+struct router_ring {
+    int memfd;
+    int cmd_fd;
+    int ack_fd;
+    size_t size;
+    ring_header *header;
+    router_ring_cmd *cmds;
+    router_ring_ack *acks;
+    uint32_t slots;
+};
+
+/**
+ * @brief This function creates the ring, its shared memory and its doorbells.
+ * @param slots: The number of slots of each ring, rounded up to a power of two.
+ * @return router_ring*: The new ring, NULL on failure.
+ */
+router_ring* router_ring_new(uint32_t slots) {
+    router_ring *ring;
+    size_t cmd_size;
+    size_t ack_size;
+
+    ring = pa_xnew0(router_ring, 1);
+    ring->memfd = ring->cmd_fd = ring->ack_fd = -1;
+    ring->slots = pa_make_power_of_two(PA_MAX(slots, 2U));
+
+    cmd_size = ring->slots * sizeof(router_ring_cmd);
+    ack_size = ring->slots * sizeof(router_ring_ack);
+    ring->size = PA_PAGE_ALIGN(sizeof(ring_header) + cmd_size + ack_size);
+
+    do {
+        if ( (ring->memfd = memfd_create("pulseaudio-router-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0 ) {
+            pa_log_error("%s: memfd_create failed: %s", __FILE__, pa_cstrerror(errno));
+            break;
+        }
+        if ( ftruncate(ring->memfd, (off_t) ring->size) < 0 ) {
+            pa_log_error("%s: ftruncate failed: %s", __FILE__, pa_cstrerror(errno));
+            break;
+        }
+        /* the audiomanager maps the same file, it must not be able to pull the pages from under us */
+        if ( fcntl(ring->memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) < 0 ) {
+            pa_log_error("%s: sealing the ring failed: %s", __FILE__, pa_cstrerror(errno));
+            break;
+        }
+        ring->header = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->memfd, 0);
+        if ( ring->header == MAP_FAILED ) {
+            ring->header = NULL;
+            pa_log_error("%s: mmap failed: %s", __FILE__, pa_cstrerror(errno));
+            break;
+        }
+        if ( ((ring->cmd_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+                || ((ring->ack_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) ) {
+            pa_log_error("%s: eventfd failed: %s", __FILE__, pa_cstrerror(errno));
+            break;
+        }
+
+        ring->header->magic = ROUTER_RING_MAGIC;
+        ring->header->version = ROUTER_RING_VERSION;
+        ring->header->slots = ring->slots;
+        ring->header->cmd_offset = sizeof(ring_header);
+        ring->header->ack_offset = sizeof(ring_header) + cmd_size;
+        ring->cmds = (router_ring_cmd *) ((uint8_t *) ring->header + ring->header->cmd_offset);
+        ring->acks = (router_ring_ack *) ((uint8_t *) ring->header + ring->header->ack_offset);
+        return ring;
+    } while ( 0 );
+
+    router_ring_free(ring);
+    return NULL;
+}
+
+/**
+ * @brief This function unmaps the ring and closes its file descriptors.
+ * @param ring: The ring.
+ * @return void
+ */
+void router_ring_free(router_ring *ring) {
+    if ( ring == NULL ) {
+        return;
+    }
+    if ( ring->header ) {
+        munmap(ring->header, ring->size);
+    }
+    if ( ring->memfd >= 0 ) {
+        pa_close(ring->memfd);
+    }
+    if ( ring->cmd_fd >= 0 ) {
+        pa_close(ring->cmd_fd);
+    }
+    if ( ring->ack_fd >= 0 ) {
+        pa_close(ring->ack_fd);
+    }
+    pa_xfree(ring);
+}
+
+int router_ring_memfd(const router_ring *ring) {
+    return ring->memfd;
+}
+
+int router_ring_cmd_doorbell(const router_ring *ring) {
+    return ring->cmd_fd;
+}
+
+int router_ring_ack_doorbell(const router_ring *ring) {
+    return ring->ack_fd;
+}
+
+uint32_t router_ring_slots(const router_ring *ring) {
+    return ring->slots;
+}
+
+/**
+ * @brief This function resets the command doorbell before the command ring is drained.
+ * @param ring: The ring.
+ * @return void
+ */
+void router_ring_clear_cmd_doorbell(router_ring *ring) {
+    uint64_t count;
+
+    while ( read(ring->cmd_fd, &count, sizeof(count)) < 0 && errno == EINTR ) {
+    }
+}
+
+/**
+ * @brief This function takes the oldest command off the command ring.
+ * @param ring: The ring.
+ *        cmd: The command to be filled.
+ * @return bool true if a command was taken, false if the ring is empty.
+ */
+bool router_ring_pop_cmd(router_ring *ring, router_ring_cmd *cmd) {
+    uint32_t head = (uint32_t) pa_atomic_load(&ring->header->cmd_head.value);
+    uint32_t tail = (uint32_t) pa_atomic_load(&ring->header->cmd_tail.value);
+
+    if ( head == tail ) {
+        return false;
+    }
+    /* the tail is written by the other process, never trust it to index the ring */
+    if ( tail - head > ring->slots ) {
+        pa_log_warn("%s: command ring corrupted, head %u tail %u", __FILE__, head, tail);
+        pa_atomic_store(&ring->header->cmd_head.value, (int) tail);
+        return false;
+    }
+    *cmd = ring->cmds[head & (ring->slots - 1)];
+    pa_atomic_store(&ring->header->cmd_head.value, (int) (head + 1));
+    return true;
+}
+
+/**
+ * @brief This function appends an ack to the ack ring, the doorbell is rung separately so that a batch of acks
+ * costs a single wakeup.
+ * @param ring: The ring.
+ *        ack: The ack.
+ * @return bool true on success, false if the ring is full.
+ */
+bool router_ring_push_ack(router_ring *ring, const router_ring_ack *ack) {
+    uint32_t head = (uint32_t) pa_atomic_load(&ring->header->ack_head.value);
+    uint32_t tail = (uint32_t) pa_atomic_load(&ring->header->ack_tail.value);
+
+    if ( tail - head >= ring->slots ) {
+        return false;
+    }
+    ring->acks[tail & (ring->slots - 1)] = *ack;
+    pa_atomic_store(&ring->header->ack_tail.value, (int) (tail + 1));
+    return true;
+}
+
+/**
+ * @brief This function wakes the audiomanager up to read the ack ring.
+ * @param ring: The ring.
+ * @return void
+ */
+void router_ring_ring_ack_doorbell(router_ring *ring) {
+    uint64_t one = 1;
+
+    while ( write(ring->ack_fd, &one, sizeof(one)) < 0 && errno == EINTR ) {
+    }
+}
+
+#endif /* HAVE_MEMFD */
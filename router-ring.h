@@ -0,0 +1,68 @@
+/******************************************************************************
+ * @file: router-ring.h
+ *
+ * The file contains the declarations of the shared memory command ring which
+ * carries the high rate volume commands of the audiomanager and their acks
+ * next to the D-Bus interface of the router module.
+ *
+ * @component: PulseAudio router module
+ *
+ * @author: Toshiaki Isogai <tisogai@jp.adit-jv.com>
+ *          Kapildev Patel  <kpatel@jp.adit-jv.com>
+ *
+ * @copyright (c) 2016 Advanced Driver Information Technology.
+ * This code is developed by Advanced Driver Information Technology.
+ * Copyright of Advanced Driver Information Technology, Bosch, and DENSO.
+ * All rights reserved.
+ *
+ *****************************************************************************/
+
+#ifndef __ROUTER_RING_H__
+#define __ROUTER_RING_H__
+
+#define ROUTER_RING_MAGIC    0x52524e47
+#define ROUTER_RING_VERSION  1
+#define ROUTER_RING_SLOTS    64
+
+#define RING_CMD_SET_SINK_VOLUME    1
+#define RING_CMD_SET_SOURCE_VOLUME  2
+
+/*
+ * The commands and acks are fixed size records. The layout is part of the
+ * protocol with the audiomanager, change ROUTER_RING_VERSION with it.
+ */
+typedef struct {
+    uint16_t type;
+    uint16_t handle;
+    uint16_t id;
+    int16_t volume;
+    int16_t ramp_type;
+    uint16_t ramp_time;
+} router_ring_cmd;
+
+typedef struct {
+    uint16_t type;
+    uint16_t handle;
+    int16_t volume;
+    uint16_t error;
+} router_ring_ack;
+
+#ifdef HAVE_MEMFD
+
+router_ring* router_ring_new(uint32_t slots);
+void router_ring_free(router_ring *ring);
+
+int router_ring_memfd(const router_ring *ring);
+int router_ring_cmd_doorbell(const router_ring *ring);
+int router_ring_ack_doorbell(const router_ring *ring);
+uint32_t router_ring_slots(const router_ring *ring);
+
+/* consumer side of the command ring and producer side of the ack ring, used by the module */
+void router_ring_clear_cmd_doorbell(router_ring *ring);
+bool router_ring_pop_cmd(router_ring *ring, router_ring_cmd *cmd);
+bool router_ring_push_ack(router_ring *ring, const router_ring_ack *ack);
+void router_ring_ring_ack_doorbell(router_ring *ring);
+
+#endif /* HAVE_MEMFD */
+
+#endif /* __ROUTER_RING_H__ */
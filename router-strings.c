@@ -0,0 +1,162 @@
+/******************************************************************************
+ * @file: router-strings.c
+ *
+ * The file contains the implementation of the interned string table which
+ * stores the audiomanager names and pulseaudio descriptions of the router
+ * module. Every distinct string is stored once and referred to by a small
+ * handle, so that equal strings compare as equal handles. The handles are
+ * reference counted, a string is freed and its handle reused once the last
+ * map entry using it lets go of it.
+ *
+ * @component: PulseAudio router module
+ *
+ * @author: Toshiaki Isogai <tisogai@jp.adit-jv.com>
+ *          Kapildev Patel  <kpatel@jp.adit-jv.com>
+ *
+ * @copyright (c) 2016 Advanced Driver Information Technology.
+ * This code is developed by Advanced Driver Information Technology.
+ * Copyright of Advanced Driver Information Technology, Bosch, and DENSO.
+ * All rights reserved.
+ *
+ *****************************************************************************/
+
+#include <pulsecore/pulsecore-config.h>
+#include <stdint.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/idxset.h>
+#include <pulsecore/hashmap.h>
+#include "router-userdata.h"
+#include "router-strings.h"
+
+#define ROUTER_STRINGS_TABLE_SIZE  32
+
+typedef struct router_strings_slot_t {
+    char *string;
+    uint32_t refs;
+} router_strings_slot;
+
+struct router_strings {
+    pa_hashmap *index;
+    router_strings_slot *table;
+    uint32_t count;
+    uint32_t size;
+    /* handles of the released slots, handed out again before the table grows */
+    router_str *free_handles;
+    uint32_t free_count;
+};
+
+/**
+ * @brief This function creates an empty string table.
+ * @param void
+ * @return router_strings*: The pointer to the string table.
+ */
+router_strings* router_strings_new(void) {
+    router_strings *strings = pa_xnew0(router_strings, 1);
+    strings->index = pa_hashmap_new(pa_idxset_string_hash_func, pa_idxset_string_compare_func);
+    return strings;
+}
+
+/**
+ * @brief This function releases the string table and all the strings stored in it.
+ * @param strings: The pointer to the string table.
+ * @return void
+ */
+void router_strings_free(router_strings *strings) {
+    if ( strings == NULL ) {
+        return;
+    }
+    pa_hashmap_free(strings->index);
+    for ( uint32_t i = 0 ; i < strings->count ; i++ ) {
+        MODULE_ROUTER_FREE(strings->table[i].string);
+    }
+    MODULE_ROUTER_FREE(strings->table);
+    MODULE_ROUTER_FREE(strings->free_handles);
+    pa_xfree(strings);
+}
+
+/**
+ * @brief This function returns the handle of a string and stores the string if it is not yet known.
+ * Every call takes a reference on the handle, which is given back with router_strings_unref().
+ * @param strings: The pointer to the string table.
+ *        string: The string to be interned.
+ * @return router_str: The handle of the string, 0 for a NULL or empty string.
+ */
+router_str router_strings_intern(router_strings *strings, const char *string) {
+    router_str handle;
+    router_strings_slot *slot;
+    pa_assert(strings);
+    if ( (string == NULL) || (string[0] == '\0') ) {
+        return 0;
+    }
+    handle = router_strings_find(strings, string);
+    if ( handle != 0 ) {
+        strings->table[handle - 1].refs++;
+        return handle;
+    }
+    if ( strings->free_count > 0 ) {
+        handle = strings->free_handles[--strings->free_count];
+    } else {
+        if ( strings->count == strings->size ) {
+            strings->size = (strings->size == 0) ? ROUTER_STRINGS_TABLE_SIZE : (2 * strings->size);
+            strings->table = pa_xrenew(router_strings_slot, strings->table, strings->size);
+            strings->free_handles = pa_xrenew(router_str, strings->free_handles, strings->size);
+        }
+        handle = ++strings->count;
+    }
+    slot = &strings->table[handle - 1];
+    slot->string = pa_xstrdup(string);
+    slot->refs = 1;
+    pa_hashmap_put(strings->index, slot->string, (void*) (uintptr_t) handle);
+    return handle;
+}
+
+/**
+ * @brief This function gives back a reference taken by router_strings_intern(). The string is freed
+ * with its last reference and its handle may then be returned for another string.
+ * @param strings: The pointer to the string table.
+ *        handle: The handle of the string, 0 is ignored.
+ * @return void
+ */
+void router_strings_unref(router_strings *strings, router_str handle) {
+    router_strings_slot *slot;
+    pa_assert(strings);
+    pa_assert(handle <= strings->count);
+    if ( handle == 0 ) {
+        return;
+    }
+    slot = &strings->table[handle - 1];
+    pa_assert(slot->refs > 0);
+    if ( --slot->refs > 0 ) {
+        return;
+    }
+    pa_hashmap_remove(strings->index, slot->string);
+    pa_xfree(slot->string);
+    slot->string = NULL;
+    strings->free_handles[strings->free_count++] = handle;
+}
+
+/**
+ * @brief This function returns the handle of a string which is already stored.
+ * @param strings: The pointer to the string table.
+ *        string: The string to be searched.
+ * @return router_str: The handle of the string, 0 if the string is not stored.
+ */
+router_str router_strings_find(const router_strings *strings, const char *string) {
+    pa_assert(strings);
+    if ( (string == NULL) || (string[0] == '\0') ) {
+        return 0;
+    }
+    return (router_str) (uintptr_t) pa_hashmap_get(strings->index, string);
+}
+
+/**
+ * @brief This function returns the string of a handle.
+ * @param strings: The pointer to the string table.
+ *        handle: The handle of the string.
+ * @return const char*: The string, an empty string for the handle 0.
+ */
+const char* router_strings_get(const router_strings *strings, router_str handle) {
+    pa_assert(strings);
+    pa_assert(handle <= strings->count);
+    return (handle == 0) ? "" : strings->table[handle - 1].string;
+}
@@ -0,0 +1,31 @@
+/******************************************************************************
+ * @file: router-strings.h
+ *
+ * The file contains the declarations of the interned string table which
+ * stores the audiomanager names and pulseaudio descriptions of the router
+ * module.
+ *
+ * @component: PulseAudio router module
+ *
+ * @author: Toshiaki Isogai <tisogai@jp.adit-jv.com>
+ *          Kapildev Patel  <kpatel@jp.adit-jv.com>
+ *
+ * @copyright (c) 2016 Advanced Driver Information Technology.
+ * This code is developed by Advanced Driver Information Technology.
+ * Copyright of Advanced Driver Information Technology, Bosch, and DENSO.
+ * All rights reserved.
+ *
+ *****************************************************************************/
+
+#ifndef __ROUTER_STRINGS_H__
+#define __ROUTER_STRINGS_H__
+
+router_strings* router_strings_new(void);
+void router_strings_free(router_strings *strings);
+
+router_str router_strings_intern(router_strings *strings, const char *string);
+void router_strings_unref(router_strings *strings, router_str handle);
+router_str router_strings_find(const router_strings *strings, const char *string);
+const char* router_strings_get(const router_strings *strings, router_str handle);
+
+#endif /* __ROUTER_STRINGS_H__ */
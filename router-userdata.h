@@ -21,34 +21,92 @@
 
 #include <pulsecore/protocol-dbus.h>
 #include <pulsecore/log.h>
+#include <pulsecore/hashmap.h>
+#include <pulsecore/module.h>
 
 typedef struct router_dbusif router_dbusif;
 typedef struct router_hooks router_hooks;
+typedef struct router_strings router_strings;
+typedef struct router_connection_table router_connection_table;
+typedef struct router_ring router_ring;
 
-#define AM_MAX_SOURCE_SINK    100
+/* handle of an interned string, 0 is the empty string */
+typedef uint32_t router_str;
+
+#define AM_MAP_INITIAL_SIZE   16
+#define AM_MAP_MAX_SIZE       INT16_MAX
 #define AM_MAX_NAME_LENGTH    256
 
+/*
+ * Links of the entries which share a name or a description, the string index
+ * points to the first of them. The links hold the map index incremented by
+ * one, 0 ends the list.
+ */
+typedef struct router_str_link_t {
+    int16_t prev;
+    int16_t next;
+} router_str_link;
+
+/*
+ * The fields of a map entry which are only touched when the entry itself is
+ * updated. The fields used by the lookups live in the per field arrays of
+ * router_map.
+ */
 typedef struct name_id_map_t {
-    uint16_t id;
-    uint16_t domain_id;
-    bool builtin;
-    uint16_t source_state;
+    bool in_use;
     float volume;
     bool volume_valid;
-    void* data;
-    char name[AM_MAX_NAME_LENGTH];
-    char description[AM_MAX_NAME_LENGTH];
+    router_str name;
+    router_str description;
+    router_str_link name_link;
+    router_str_link description_link;
 } name_id_map;
 
+/*
+ * AudioManager ids are 16 bit wide. The id index is split into pages of
+ * AM_ID_INDEX_PAGE_SIZE slots which are only allocated when an id from
+ * that range is used.
+ */
+#define AM_ID_INDEX_PAGE_SHIFT 8
+#define AM_ID_INDEX_PAGE_SIZE  (1 << AM_ID_INDEX_PAGE_SHIFT)
+#define AM_ID_INDEX_PAGES      (65536 >> AM_ID_INDEX_PAGE_SHIFT)
+
+/*
+ * The map is stored as a structure of arrays, all of them have size elements
+ * and are indexed by the map index. The entries grow on demand. Released
+ * slots are kept on the free_slots stack and handed out again by
+ * router_map_alloc().
+ */
+typedef struct router_map_t {
+    uint16_t *id;
+    uint16_t *domain_id;
+    bool *builtin;
+    uint16_t *source_state;
+    void **data;
+    name_id_map *entry;
+    int16_t size;
+    int16_t *free_slots;
+    int16_t free_count;
+    router_strings *strings;
+    pa_hashmap *name_index;
+    pa_hashmap *description_index;
+    pa_hashmap *data_index;
+    uint32_t *id_index[AM_ID_INDEX_PAGES];
+} router_map;
+
 struct userdata {
     pa_core *core;
+    pa_module *module;
     router_hooks *h;
     router_dbusif *dbusif;
-    pa_hashmap *main_connection_map;
-    pa_hashmap *connection_map;
+    router_connection_table *main_connection_map;
+    router_connection_table *connection_map;
+    pa_hashmap *source_admissions;
+    pa_hashmap *sink_admissions;
     void* domain;
-    name_id_map sink_map[AM_MAX_SOURCE_SINK];
-    name_id_map source_map[AM_MAX_SOURCE_SINK];
+    router_strings *strings;
+    router_map sink_map;
+    router_map source_map;
 
 };
 
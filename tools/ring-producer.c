@@ -0,0 +1,427 @@
+/******************************************************************************
+ * @file: ring-producer.c
+ *
+ * The file contains a stand-in for the audiomanager side of the shared memory
+ * command ring. It opens the ring of a running router module, pushes a burst
+ * of set volume commands, rings the command doorbell and checks that every
+ * command comes back acked on the ack ring.
+ *
+ * openRing is only accepted from the audiomanager, so the producer takes the
+ * audiomanager name on the bus before it asks for the ring. It must not run
+ * next to a real audiomanager.
+ *
+ * @component: PulseAudio router module
+ *
+ * @author: Toshiaki Isogai <tisogai@jp.adit-jv.com>
+ *          Kapildev Patel  <kpatel@jp.adit-jv.com>
+ *
+ * @copyright (c) 2016 Advanced Driver Information Technology.
+ * This code is developed by Advanced Driver Information Technology.
+ * Copyright of Advanced Driver Information Technology, Bosch, and DENSO.
+ * All rights reserved.
+ *
+ *****************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dbus/dbus.h>
+
+/* the module side declarations of router-ring.h need the ring type */
+typedef struct router_ring router_ring;
+#include "router-ring.h"
+
+#define AM_DBUS_NAME "org.genivi.audiomanager"
+#define ROUTER_DBUS_NAME "org.genivi.audiomanager.routing.pulseaudio"
+#define ROUTER_DBUS_PATH "/org/genivi/audiomanager/routing/pulseaudio"
+#define ROUTER_INTERFACE_NAME "org.genivi.audiomanager.routing.pulseaudio"
+
+#define CALL_TIMEOUT 5000
+#define ACK_TIMEOUT 5000
+
+#define RING_CACHELINE 64
+
+/* the head of the shared memory, it mirrors ring_header of router-ring.c */
+typedef struct {
+    int32_t value;
+    uint8_t pad[RING_CACHELINE - sizeof(int32_t)];
+} ring_index;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t cmd_offset;
+    uint32_t ack_offset;
+    uint8_t pad[RING_CACHELINE - 5 * sizeof(uint32_t)];
+    ring_index cmd_head;
+    ring_index cmd_tail;
+    ring_index ack_head;
+    ring_index ack_tail;
+} ring_header;
+
+typedef struct {
+    int memfd;
+    int cmd_fd;
+    int ack_fd;
+    size_t size;
+    ring_header *header;
+    router_ring_cmd *cmds;
+    router_ring_ack *acks;
+    uint32_t slots;
+} producer_ring;
+
+/**
+ * @brief This function connects to the bus and takes the audiomanager name, so that the module accepts openRing.
+ * @param address: The bus address, NULL for the system bus.
+ * @return DBusConnection*: The connection, NULL on failure.
+ */
+static DBusConnection* bus_open(const char *address) {
+    DBusConnection *conn;
+    DBusError error;
+    int result;
+
+    dbus_error_init(&error);
+    if ( address ) {
+        conn = dbus_connection_open_private(address, &error);
+        if ( conn && (dbus_bus_register(conn, &error) == FALSE) ) {
+            dbus_connection_close(conn);
+            dbus_connection_unref(conn);
+            conn = NULL;
+        }
+    } else {
+        conn = dbus_bus_get_private(DBUS_BUS_SYSTEM, &error);
+    }
+    if ( conn == NULL ) {
+        fprintf(stderr, "connecting to the bus failed: %s\n", error.message);
+        dbus_error_free(&error);
+        return NULL;
+    }
+    dbus_connection_set_exit_on_disconnect(conn, FALSE);
+
+    result = dbus_bus_request_name(conn, AM_DBUS_NAME, DBUS_NAME_FLAG_DO_NOT_QUEUE, &error);
+    if ( result != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER ) {
+        fprintf(stderr, "taking the name %s failed: %s\n", AM_DBUS_NAME,
+                dbus_error_is_set(&error) ? error.message : "the name has an owner");
+        dbus_error_free(&error);
+        dbus_connection_close(conn);
+        dbus_connection_unref(conn);
+        return NULL;
+    }
+    return conn;
+}
+
+/**
+ * @brief This function calls a method without arguments on the router object.
+ * @param conn: The bus connection.
+ *        member: The method name.
+ * @return DBusMessage*: The reply, NULL on failure.
+ */
+static DBusMessage* router_call(DBusConnection *conn, const char *member) {
+    DBusMessage *msg;
+    DBusMessage *reply;
+    DBusError error;
+
+    msg = dbus_message_new_method_call(ROUTER_DBUS_NAME, ROUTER_DBUS_PATH, ROUTER_INTERFACE_NAME, member);
+    if ( msg == NULL ) {
+        return NULL;
+    }
+    dbus_error_init(&error);
+    reply = dbus_connection_send_with_reply_and_block(conn, msg, CALL_TIMEOUT, &error);
+    dbus_message_unref(msg);
+    if ( reply == NULL ) {
+        fprintf(stderr, "%s failed: %s\n", member, error.message);
+        dbus_error_free(&error);
+    }
+    return reply;
+}
+
+/**
+ * @brief This function opens the ring of the module and maps its shared memory.
+ * @param conn: The bus connection.
+ *        ring: The ring to be filled.
+ * @return bool true on success.
+ */
+static bool ring_open(DBusConnection *conn, producer_ring *ring) {
+    DBusMessage *reply;
+    DBusError error;
+    dbus_uint32_t slots;
+    struct stat st;
+    bool status = false;
+
+    reply = router_call(conn, "openRing");
+    if ( reply == NULL ) {
+        return false;
+    }
+    dbus_error_init(&error);
+    if ( dbus_message_get_args(reply, &error, DBUS_TYPE_UNIX_FD, &ring->memfd, DBUS_TYPE_UNIX_FD, &ring->cmd_fd,
+            DBUS_TYPE_UNIX_FD, &ring->ack_fd, DBUS_TYPE_UINT32, &slots, DBUS_TYPE_INVALID) == FALSE ) {
+        fprintf(stderr, "parsing the openRing reply failed: %s\n", error.message);
+        dbus_error_free(&error);
+        dbus_message_unref(reply);
+        return false;
+    }
+    dbus_message_unref(reply);
+
+    do {
+        if ( fstat(ring->memfd, &st) < 0 ) {
+            fprintf(stderr, "fstat of the ring failed: %s\n", strerror(errno));
+            break;
+        }
+        ring->size = (size_t) st.st_size;
+        if ( ring->size < sizeof(ring_header) ) {
+            fprintf(stderr, "the ring of %zu bytes is too small\n", ring->size);
+            break;
+        }
+        ring->header = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->memfd, 0);
+        if ( ring->header == MAP_FAILED ) {
+            ring->header = NULL;
+            fprintf(stderr, "mmap of the ring failed: %s\n", strerror(errno));
+            break;
+        }
+        if ( (ring->header->magic != ROUTER_RING_MAGIC) || (ring->header->version != ROUTER_RING_VERSION) ) {
+            fprintf(stderr, "unknown ring magic %#x version %u\n", ring->header->magic, ring->header->version);
+            break;
+        }
+        ring->slots = ring->header->slots;
+        if ( (ring->slots != slots) || (ring->slots == 0) || (ring->slots & (ring->slots - 1))
+                || (ring->header->cmd_offset + ring->slots * sizeof(router_ring_cmd) > ring->size)
+                || (ring->header->ack_offset + ring->slots * sizeof(router_ring_ack) > ring->size) ) {
+            fprintf(stderr, "bad ring geometry, %u slots in the reply and %u in the ring\n", slots, ring->slots);
+            break;
+        }
+        ring->cmds = (router_ring_cmd *) ((uint8_t *) ring->header + ring->header->cmd_offset);
+        ring->acks = (router_ring_ack *) ((uint8_t *) ring->header + ring->header->ack_offset);
+        status = true;
+    } while ( 0 );
+
+    return status;
+}
+
+/**
+ * @brief This function unmaps the ring and closes its file descriptors.
+ * @param ring: The ring.
+ * @return void
+ */
+static void ring_close(producer_ring *ring) {
+    if ( ring->header ) {
+        munmap(ring->header, ring->size);
+    }
+    if ( ring->memfd >= 0 ) {
+        close(ring->memfd);
+    }
+    if ( ring->cmd_fd >= 0 ) {
+        close(ring->cmd_fd);
+    }
+    if ( ring->ack_fd >= 0 ) {
+        close(ring->ack_fd);
+    }
+}
+
+/**
+ * @brief This function appends a command to the command ring.
+ * @param ring: The ring.
+ *        cmd: The command.
+ * @return bool true on success, false if the ring is full.
+ */
+static bool ring_push_cmd(producer_ring *ring, const router_ring_cmd *cmd) {
+    uint32_t head = (uint32_t) __atomic_load_n(&ring->header->cmd_head.value, __ATOMIC_ACQUIRE);
+    uint32_t tail = (uint32_t) ring->header->cmd_tail.value;
+
+    if ( tail - head >= ring->slots ) {
+        return false;
+    }
+    ring->cmds[tail & (ring->slots - 1)] = *cmd;
+    __atomic_store_n(&ring->header->cmd_tail.value, (int32_t) (tail + 1), __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief This function takes the oldest ack off the ack ring.
+ * @param ring: The ring.
+ *        ack: The ack to be filled.
+ * @return bool true if an ack was taken, false if the ring is empty.
+ */
+static bool ring_pop_ack(producer_ring *ring, router_ring_ack *ack) {
+    uint32_t head = (uint32_t) ring->header->ack_head.value;
+    uint32_t tail = (uint32_t) __atomic_load_n(&ring->header->ack_tail.value, __ATOMIC_ACQUIRE);
+
+    if ( head == tail ) {
+        return false;
+    }
+    *ack = ring->acks[head & (ring->slots - 1)];
+    __atomic_store_n(&ring->header->ack_head.value, (int32_t) (head + 1), __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief This function writes or drains an eventfd doorbell.
+ * @param fd: The doorbell.
+ *        ring: true to ring it, false to clear it.
+ * @return void
+ */
+static void doorbell(int fd, bool ring) {
+    uint64_t count = 1;
+
+    if ( ring ) {
+        while ( write(fd, &count, sizeof(count)) < 0 && errno == EINTR ) {
+        }
+    } else {
+        while ( read(fd, &count, sizeof(count)) < 0 && errno == EINTR ) {
+        }
+    }
+}
+
+/**
+ * @brief This function pushes the set volume commands and checks their acks. No more commands than the ring has
+ * slots are in flight, so the module never runs out of ack slots and falls back to D-Bus acks.
+ * @param ring: The ring.
+ *        type: RING_CMD_SET_SINK_VOLUME or RING_CMD_SET_SOURCE_VOLUME.
+ *        id: The sink or source ID.
+ *        volume: The volume to set.
+ *        count: The number of commands.
+ * @return int: The number of failed checks.
+ */
+static int run(producer_ring *ring, uint16_t type, uint16_t id, int16_t volume, uint32_t count) {
+    router_ring_cmd cmd;
+    router_ring_ack ack;
+    struct pollfd pfd;
+    uint8_t *acked;
+    uint32_t pushed = 0;
+    uint32_t received = 0;
+    uint32_t refused = 0;
+    int failures = 0;
+    bool rang;
+
+    acked = calloc(count, 1);
+    if ( acked == NULL ) {
+        return 1;
+    }
+    pfd.fd = ring->ack_fd;
+    pfd.events = POLLIN;
+
+    while ( received < count ) {
+        rang = false;
+        while ( (pushed < count) && (pushed - received < ring->slots) ) {
+            memset(&cmd, 0, sizeof(cmd));
+            cmd.type = type;
+            /* handle 0 is never used, so an ack read from a slot the module did not write is caught */
+            cmd.handle = (uint16_t) (pushed + 1);
+            cmd.id = id;
+            cmd.volume = volume;
+            if ( !ring_push_cmd(ring, &cmd) ) {
+                break;
+            }
+            pushed++;
+            rang = true;
+        }
+        if ( rang ) {
+            doorbell(ring->cmd_fd, true);
+        }
+
+        if ( poll(&pfd, 1, ACK_TIMEOUT) <= 0 ) {
+            fprintf(stderr, "no ack within %d ms, %u of %u acked\n", ACK_TIMEOUT, received, count);
+            failures++;
+            break;
+        }
+        doorbell(ring->ack_fd, false);
+        while ( ring_pop_ack(ring, &ack) ) {
+            if ( (ack.handle == 0) || (ack.handle > pushed) || acked[ack.handle - 1] ) {
+                fprintf(stderr, "unexpected ack of handle %u\n", ack.handle);
+                failures++;
+                continue;
+            }
+            acked[ack.handle - 1] = 1;
+            received++;
+            if ( ack.type != type ) {
+                fprintf(stderr, "ack of handle %u has type %u, expected %u\n", ack.handle, ack.type, type);
+                failures++;
+            }
+            if ( ack.error != 0 ) {
+                refused++;
+            } else if ( ack.volume != volume ) {
+                fprintf(stderr, "ack of handle %u has volume %d, expected %d\n", ack.handle, ack.volume, volume);
+                failures++;
+            }
+        }
+    }
+
+    printf("%u commands pushed, %u acked, %u acked with an error\n", pushed, received, refused);
+    free(acked);
+    return failures;
+}
+
+/**
+ * @brief This function prints the command line arguments.
+ * @param name: The program name.
+ * @return void
+ */
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-s sink_id | -S source_id] [-v volume] [-n count] [-a bus_address]\n", name);
+}
+
+int main(int argc, char *argv[]) {
+    DBusConnection *conn;
+    DBusMessage *reply;
+    producer_ring ring;
+    const char *address = NULL;
+    uint16_t type = RING_CMD_SET_SINK_VOLUME;
+    uint16_t id = 1;
+    int16_t volume = 0;
+    uint32_t count = 2 * ROUTER_RING_SLOTS;
+    int failures = 1;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "s:S:v:n:a:")) != -1 ) {
+        switch ( opt ) {
+            case 's':
+                type = RING_CMD_SET_SINK_VOLUME;
+                id = (uint16_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'S':
+                type = RING_CMD_SET_SOURCE_VOLUME;
+                id = (uint16_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'v':
+                volume = (int16_t) strtol(optarg, NULL, 0);
+                break;
+            case 'n':
+                count = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'a':
+                address = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if ( (count == 0) || (count > UINT16_MAX) ) {
+        fprintf(stderr, "the count must be between 1 and %u\n", UINT16_MAX);
+        return 2;
+    }
+
+    if ( (conn = bus_open(address)) == NULL ) {
+        return 1;
+    }
+    memset(&ring, 0, sizeof(ring));
+    ring.memfd = ring.cmd_fd = ring.ack_fd = -1;
+    if ( ring_open(conn, &ring) ) {
+        failures = run(&ring, type, id, volume, count);
+        if ( (reply = router_call(conn, "closeRing")) != NULL ) {
+            dbus_message_unref(reply);
+        }
+    }
+    ring_close(&ring);
+    dbus_connection_close(conn);
+    dbus_connection_unref(conn);
+
+    return failures ? 1 : 0;
+}